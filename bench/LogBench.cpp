@@ -0,0 +1,96 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+// Measures what a LOGI call costs the calling thread when records are
+// formatted immediately, written by the asynchronous writer and formatted by
+// the deferred writer. Build it with `make MarathonKitLogBench`, it is not
+// part of the tests. The optional argument is the number of records per mode.
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "LogMacro.h"
+
+using MarathonKit::Core::Log;
+
+static const int WARM_UP_RECORD_COUNT = 1000;
+
+static double measureNanosecondsPerCall(int recordCount);
+static double getThreadCpuNanoseconds();
+
+int main(int argc, char** argv) {
+  int recordCount = argc > 1 ? std::atoi(argv[1]) : 100000;
+  // Records always go to stderr, the results are printed to stdout.
+  int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  if (devNull < 0 || dup2(devNull, STDERR_FILENO) < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  close(devNull);
+
+  measureNanosecondsPerCall(WARM_UP_RECORD_COUNT);
+  std::printf(
+      "immediate: %.1f ns per call\n",
+      measureNanosecondsPerCall(recordCount));
+
+  // The queue takes every record, so the caller never waits for the writer.
+  Log::enableAsync(static_cast<size_t>(recordCount + WARM_UP_RECORD_COUNT));
+  measureNanosecondsPerCall(WARM_UP_RECORD_COUNT);
+  std::printf(
+      "async: %.1f ns per call\n",
+      measureNanosecondsPerCall(recordCount));
+  Log::flush();
+  Log::disableAsync();
+
+  Log::enableDeferredFormatting(
+      static_cast<size_t>(recordCount + WARM_UP_RECORD_COUNT) * 128);
+  measureNanosecondsPerCall(WARM_UP_RECORD_COUNT);
+  std::printf(
+      "deferred: %.1f ns per call\n",
+      measureNanosecondsPerCall(recordCount));
+  Log::flush();
+  Log::disableDeferredFormatting();
+  return 0;
+}
+
+// Thread CPU time leaves out the time the background writers take.
+static double measureNanosecondsPerCall(int recordCount) {
+  double start = getThreadCpuNanoseconds();
+  for (int i = 0; i < recordCount; ++i) {
+    LOGI("value ", i, " x ", 0.5 * i);
+  }
+  return (getThreadCpuNanoseconds() - start) / recordCount;
+}
+
+static double getThreadCpuNanoseconds() {
+  timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return static_cast<double>(time.tv_sec) * 1e9 +
+      static_cast<double>(time.tv_nsec);
+}
@@ -26,6 +26,8 @@
 
 #include "Core/Log.h"
 #include "Core/Network.h"
+#include "Core/TcpAcceptorPool.h"
 #include "Core/TcpClient.h"
+#include "Core/TcpPipeline.h"
 
 #endif
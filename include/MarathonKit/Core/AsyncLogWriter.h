@@ -0,0 +1,94 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_ASYNC_LOG_WRITER_H_
+#define MARATHON_KIT_CORE_ASYNC_LOG_WRITER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Log.h"
+#include "MpscQueue.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Takes formatted log records from any number of threads through a lock-free
+// queue and hands them to the output on a background thread, concatenated
+// into batches, so that logging threads never wait for a system call.
+class AsyncLogWriter {
+public:
+
+  typedef std::function<void(const std::string&)> Output;
+
+  AsyncLogWriter(
+      size_t capacity,
+      Log::OverflowPolicy policy,
+      Output output);
+
+  // Writes all queued records before returning.
+  ~AsyncLogWriter();
+
+  void push(std::string&& record);
+
+  // Blocks until all records pushed before the call have been written.
+  void flush();
+
+  size_t getDroppedCount() const { return mDroppedCount; }
+
+private:
+
+  AsyncLogWriter(const AsyncLogWriter&) = delete;
+  AsyncLogWriter& operator = (const AsyncLogWriter&) = delete;
+
+  void run();
+  void wakeWriter();
+
+  MpscQueue<std::string> mQueue;
+  const Log::OverflowPolicy mPolicy;
+  const Output mOutput;
+
+  // Records leave the queue in the order in which they took their slots, so
+  // this is also the number of slots whose records have been written.
+  std::atomic<size_t> mWrittenCount;
+  std::atomic<size_t> mDroppedCount;
+  std::atomic<bool> mStopping;
+
+  // Only used when the writer thread sleeps or someone waits for a flush.
+  std::mutex mMutex;
+  std::condition_variable mRecordAvailable;
+  std::condition_variable mBatchWritten;
+  std::atomic<bool> mWriterWaiting;
+
+  std::thread mThread;
+
+};
+
+}}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_BACKGROUND_RECEIVER_H_
+#define MARATHON_KIT_CORE_BACKGROUND_RECEIVER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "FileDescriptor.h"
+#include "LineBuffer.h"
+#include "SpscQueue.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Reads lines on a dedicated thread and hands them over through a lock-free
+// queue, so that the consuming thread never makes a system call just to find
+// out whether a line is ready. Only one thread may consume the lines.
+class BackgroundReceiver {
+public:
+
+  explicit BackgroundReceiver(LineBuffer&& lineBuffer);
+  ~BackgroundReceiver();
+
+  // Wait-free.
+  size_t linesReady();
+
+  // Blocks while the queue is empty. Rethrows the error that stopped the
+  // reader thread (for example a closed connection) once all lines received
+  // before it were consumed.
+  std::string getLine();
+  bool getLine(std::string& line, FileDescriptor::Deadline deadline);
+
+private:
+
+  BackgroundReceiver(const BackgroundReceiver&) = delete;
+  BackgroundReceiver& operator = (const BackgroundReceiver&) = delete;
+
+  void run();
+  void push(std::string&& line);
+  bool waitForLine(FileDescriptor::Deadline deadline);
+
+  LineBuffer mLineBuffer;
+  SpscQueue<std::string> mQueue;
+
+  std::atomic<bool> mStopping;
+  std::atomic<bool> mFinished;
+  std::exception_ptr mError;
+
+  // Only used when the consumer has to sleep because the queue is empty.
+  std::mutex mMutex;
+  std::condition_variable mLineAvailable;
+  std::atomic<bool> mConsumerWaiting;
+
+  std::thread mThread;
+
+};
+
+}}
+
+#endif
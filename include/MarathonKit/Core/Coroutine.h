@@ -0,0 +1,259 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_COROUTINE_H_
+#define MARATHON_KIT_CORE_COROUTINE_H_
+
+// The coroutine interface needs C++20, the rest of the library only C++11.
+// Check MARATHON_KIT_HAS_COROUTINES before using anything from this file.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define MARATHON_KIT_HAS_COROUTINES 1
+#endif
+
+#ifdef MARATHON_KIT_HAS_COROUTINES
+
+#include <poll.h>
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "EventLoop.h"
+#include "TcpClient.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Return type of coroutines. The coroutine starts running immediately and
+// runs until its first co_await that has to wait. Another coroutine can
+// co_await the task to wait for it to finish. The task must be kept alive
+// until the coroutine finishes, destroying it earlier destroys the coroutine.
+class Task {
+public:
+
+  class promise_type {
+  public:
+
+    struct FinalAwaiter {
+      bool await_ready() noexcept {
+        return false;
+      }
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<promise_type> handle) noexcept {
+        if (handle.promise().mContinuation) {
+          return handle.promise().mContinuation;
+        }
+        return std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+    };
+
+    promise_type():
+      mContinuation(),
+      mError() {}
+
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+    FinalAwaiter final_suspend() noexcept {
+      return {};
+    }
+    void return_void() {}
+    void unhandled_exception() {
+      mError = std::current_exception();
+    }
+
+    std::coroutine_handle<> mContinuation;
+    std::exception_ptr mError;
+
+  };
+
+  Task(Task&& other) noexcept:
+    mHandle(std::exchange(other.mHandle, nullptr)) {}
+
+  Task& operator = (Task&& other) noexcept {
+    std::swap(mHandle, other.mHandle);
+    return *this;
+  }
+
+  ~Task() {
+    if (mHandle) {
+      mHandle.destroy();
+    }
+  }
+
+  bool isDone() const {
+    return !mHandle || mHandle.done();
+  }
+
+  // Rethrows the exception that ended the coroutine, if there was one.
+  void check() const {
+    if (mHandle && mHandle.done() && mHandle.promise().mError) {
+      std::rethrow_exception(mHandle.promise().mError);
+    }
+  }
+
+  bool await_ready() const noexcept {
+    return isDone();
+  }
+  void await_suspend(std::coroutine_handle<> awaiting) {
+    mHandle.promise().mContinuation = awaiting;
+  }
+  void await_resume() const {
+    check();
+  }
+
+private:
+
+  explicit Task(std::coroutine_handle<promise_type> handle):
+    mHandle(handle) {}
+
+  Task(const Task&) = delete;
+  Task& operator = (const Task&) = delete;
+
+  std::coroutine_handle<promise_type> mHandle;
+
+};
+
+// Awaitable that completes with the next line received by the client.
+class LineAwaiter {
+public:
+
+  LineAwaiter(EventLoop& loop, TcpClient& client):
+    mLoop(loop),
+    mClient(client),
+    mHandle(),
+    mError() {}
+
+  bool await_ready() {
+    return isLineReady();
+  }
+  void await_suspend(std::coroutine_handle<> handle) {
+    mHandle = handle;
+    watch();
+  }
+  std::string await_resume() {
+    if (mError) {
+      std::rethrow_exception(mError);
+    }
+    return mClient.getLine();
+  }
+
+private:
+
+  // Errors are kept for await_resume, so that they are thrown inside the
+  // coroutine rather than out of the event loop.
+  bool isLineReady() {
+    try {
+      return mClient.linesReady() > 0;
+    } catch (...) {
+      mError = std::current_exception();
+      return true;
+    }
+  }
+
+  void watch() {
+    mLoop.watch(mClient.getNativeHandle(), POLLIN, [this]() {
+      if (isLineReady()) {
+        mHandle.resume();
+      } else {
+        // Only part of a line has arrived so far.
+        watch();
+      }
+    });
+  }
+
+  EventLoop& mLoop;
+  TcpClient& mClient;
+  std::coroutine_handle<> mHandle;
+  std::exception_ptr mError;
+
+};
+
+// Awaitable that sends the data once the socket can accept more of it. Data
+// larger than the free space in the socket buffer may still block briefly.
+class SendAwaiter {
+public:
+
+  SendAwaiter(EventLoop& loop, TcpClient& client, std::string data):
+    mLoop(loop),
+    mClient(client),
+    mData(std::move(data)) {}
+
+  bool await_ready() {
+    return FileDescriptor::waitUntilReady(
+        mClient.getNativeHandle(),
+        POLLOUT,
+        std::chrono::steady_clock::now());
+  }
+  void await_suspend(std::coroutine_handle<> handle) {
+    mLoop.watch(mClient.getNativeHandle(), POLLOUT, [handle]() {
+      handle.resume();
+    });
+  }
+  void await_resume() {
+    mClient.sendRaw(mData);
+  }
+
+private:
+
+  EventLoop& mLoop;
+  TcpClient& mClient;
+  std::string mData;
+
+};
+
+inline LineAwaiter asyncGetLine(EventLoop& loop, TcpClient& client) {
+  if (client.hasBackgroundReceiver()) {
+    throw std::runtime_error(
+        "asyncGetLine is not available with a background receiver");
+  }
+  return LineAwaiter(loop, client);
+}
+
+inline SendAwaiter asyncSend(
+    EventLoop& loop,
+    TcpClient& client,
+    std::string data) {
+  return SendAwaiter(loop, client, std::move(data));
+}
+
+inline SendAwaiter asyncSendLine(
+    EventLoop& loop,
+    TcpClient& client,
+    std::string line) {
+  line.push_back('\n');
+  return SendAwaiter(loop, client, std::move(line));
+}
+
+}}
+
+#endif
+
+#endif
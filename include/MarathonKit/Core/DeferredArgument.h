@@ -0,0 +1,173 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_DEFERRED_ARGUMENT_H_
+#define MARATHON_KIT_CORE_DEFERRED_ARGUMENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+namespace MarathonKit {
+namespace Core {
+
+// Describes how a log argument is copied into a staging buffer as raw bytes
+// and later printed from them. Types without a specialization are not
+// supported and their records are formatted immediately instead.
+template <typename Type, typename Enable = void>
+struct DeferredArgument {
+  static const bool SUPPORTED = false;
+};
+
+template <typename Type>
+struct DeferredArgument<
+    Type,
+    typename std::enable_if<std::is_arithmetic<Type>::value>::type> {
+  static const bool SUPPORTED = true;
+
+  static size_t size(const Type&) {
+    return sizeof(Type);
+  }
+
+  static char* encode(char* output, const Type& value) {
+    std::memcpy(output, &value, sizeof(Type));
+    return output + sizeof(Type);
+  }
+
+  static const char* decode(const char* input, std::ostream& outputStream) {
+    Type value;
+    std::memcpy(&value, input, sizeof(Type));
+    outputStream << value;
+    return input + sizeof(Type);
+  }
+};
+
+// Strings are copied, because the pointers might not be valid any more by
+// the time the record is formatted.
+struct DeferredString {
+  static const bool SUPPORTED = true;
+
+  static size_t size(size_t length) {
+    return sizeof(uint32_t) + length;
+  }
+
+  static char* encode(char* output, const char* data, size_t length) {
+    uint32_t length32 = static_cast<uint32_t>(length);
+    std::memcpy(output, &length32, sizeof(length32));
+    std::memcpy(output + sizeof(length32), data, length);
+    return output + sizeof(length32) + length;
+  }
+
+  static const char* decode(const char* input, std::ostream& outputStream) {
+    uint32_t length;
+    std::memcpy(&length, input, sizeof(length));
+    outputStream.write(input + sizeof(length), length);
+    return input + sizeof(length) + length;
+  }
+};
+
+// A null pointer prints nothing, just like writing it to a stream does.
+template <>
+struct DeferredArgument<const char*> : DeferredString {
+  static size_t size(const char* value) {
+    return DeferredString::size(std::strlen(orEmpty(value)));
+  }
+
+  static char* encode(char* output, const char* value) {
+    value = orEmpty(value);
+    return DeferredString::encode(output, value, std::strlen(value));
+  }
+
+  static const char* orEmpty(const char* value) {
+    return value != nullptr ? value : "";
+  }
+};
+
+template <>
+struct DeferredArgument<char*> : DeferredArgument<const char*> {};
+
+template <size_t LENGTH>
+struct DeferredArgument<char[LENGTH]> : DeferredString {
+  static size_t size(const char (&value)[LENGTH]) {
+    return DeferredString::size(strnlen(value, LENGTH));
+  }
+
+  static char* encode(char* output, const char (&value)[LENGTH]) {
+    return DeferredString::encode(output, value, strnlen(value, LENGTH));
+  }
+};
+
+template <>
+struct DeferredArgument<std::string> : DeferredString {
+  static size_t size(const std::string& value) {
+    return DeferredString::size(value.size());
+  }
+
+  static char* encode(char* output, const std::string& value) {
+    return DeferredString::encode(output, value.data(), value.size());
+  }
+};
+
+template <typename... Types>
+struct DeferredArguments;
+
+template <>
+struct DeferredArguments<> {
+  static const bool SUPPORTED = true;
+
+  static size_t size() { return 0; }
+  static char* encode(char* output) { return output; }
+  static const char* decode(const char* input, std::ostream&) { return input; }
+};
+
+template <typename Type, typename... Types>
+struct DeferredArguments<Type, Types...> {
+  static const bool SUPPORTED =
+      DeferredArgument<Type>::SUPPORTED &&
+      DeferredArguments<Types...>::SUPPORTED;
+
+  static size_t size(const Type& object, const Types&... objects) {
+    return DeferredArgument<Type>::size(object) +
+        DeferredArguments<Types...>::size(objects...);
+  }
+
+  static char* encode(
+      char* output,
+      const Type& object,
+      const Types&... objects) {
+    output = DeferredArgument<Type>::encode(output, object);
+    return DeferredArguments<Types...>::encode(output, objects...);
+  }
+
+  static const char* decode(const char* input, std::ostream& outputStream) {
+    input = DeferredArgument<Type>::decode(input, outputStream);
+    return DeferredArguments<Types...>::decode(input, outputStream);
+  }
+};
+
+}}
+
+#endif
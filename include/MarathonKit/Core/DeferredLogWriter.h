@@ -0,0 +1,97 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_DEFERRED_LOG_WRITER_H_
+#define MARATHON_KIT_CORE_DEFERRED_LOG_WRITER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StagingBuffer.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Collects binary log records from the staging buffers of all logging
+// threads, formats them on a background thread and writes them in batches.
+class DeferredLogWriter {
+public:
+
+  // Formats the record at the input and returns its size.
+  typedef std::function<size_t(const char*, std::ostream&)> Formatter;
+  typedef std::function<void(const std::string&)> Output;
+
+  DeferredLogWriter(size_t bufferSize, Formatter formatter, Output output);
+
+  // Writes all committed records before returning.
+  ~DeferredLogWriter();
+
+  // Creates the staging buffer of the calling thread. The writer stops
+  // watching it once the thread releases it and it is empty.
+  std::shared_ptr<StagingBuffer> addThread();
+
+  // Unique for every writer ever created, so that threads can tell whether
+  // their staging buffer belongs to the current one.
+  uint64_t getId() const { return mId; }
+  size_t getBufferSize() const { return mBufferSize; }
+
+  // Blocks until all records committed before the call have been written.
+  void flush();
+
+private:
+
+  DeferredLogWriter(const DeferredLogWriter&) = delete;
+  DeferredLogWriter& operator = (const DeferredLogWriter&) = delete;
+
+  void run();
+  void drain(StagingBuffer& buffer, std::ostream& outputStream);
+  std::vector<std::shared_ptr<StagingBuffer>> takeBuffers();
+
+  const size_t mBufferSize;
+  const Formatter mFormatter;
+  const Output mOutput;
+  const uint64_t mId;
+
+  std::mutex mMutex;
+  std::vector<std::shared_ptr<StagingBuffer>> mBuffers;
+  std::condition_variable mWakeUp;
+  std::condition_variable mRoundFinished;
+  uint64_t mRoundCount;
+  std::atomic<bool> mStopping;
+
+  std::thread mThread;
+
+};
+
+}}
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_EVENT_LOOP_H_
+#define MARATHON_KIT_CORE_EVENT_LOOP_H_
+
+#include <functional>
+#include <vector>
+
+#include "FileDescriptor.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Single-threaded loop that waits for several descriptors at once and runs
+// a callback for every descriptor that becomes ready. It drives the awaitable
+// operations in Coroutine.h, but can also be used with plain callbacks.
+class EventLoop {
+public:
+
+  typedef std::function<void()> Callback;
+
+  EventLoop();
+
+  // Runs the callback once, after the descriptor becomes ready for any of the
+  // poll events or reports an error. Callbacks may add further watches.
+  void watch(int fd, short events, const Callback& callback);
+
+  bool isEmpty() const;
+  size_t getWatchCount() const;
+
+  // Waits until at least one descriptor is ready and runs its callback.
+  // Returns false if the deadline passes first. If a callback throws, the
+  // exception propagates and the watches whose callbacks did not run yet are
+  // kept.
+  bool runOnce(FileDescriptor::Deadline deadline);
+  // Runs until there is nothing left to watch.
+  void run();
+
+private:
+
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator = (const EventLoop&) = delete;
+
+  struct Watch {
+    Watch(int watchedFd, short watchedEvents, const Callback& watchCallback);
+
+    int fd;
+    short events;
+    Callback callback;
+  };
+
+  std::vector<Watch> mWatches;
+
+};
+
+}}
+
+#endif
@@ -24,6 +24,7 @@
 #ifndef MARATHON_KIT_CORE_FILE_DESCRIPTOR_H_
 #define MARATHON_KIT_CORE_FILE_DESCRIPTOR_H_
 
+#include <chrono>
 #include <string>
 
 namespace MarathonKit {
@@ -32,6 +33,9 @@ namespace Core {
 class FileDescriptor {
 public:
 
+  typedef std::chrono::system_clock::time_point Timestamp;
+  typedef std::chrono::steady_clock::time_point Deadline;
+
   virtual ~FileDescriptor() {}
 
   virtual bool isReadyForReading() const = 0;
@@ -39,10 +43,49 @@ public:
   virtual std::string read() const = 0;
   virtual void write(const std::string& data) const = 0;
 
+  // Same as read, but also stores the time at which the data arrived. The
+  // default implementation can only report the time at which read returned.
+  virtual std::string readWithTimestamp(Timestamp& arrivalTime) const;
+
+  // Whether the given result of read means that the other side closed the
+  // connection. The default treats an empty read as the end of the stream,
+  // descriptors that can receive empty messages must override it.
+  virtual bool isEndOfStream(const std::string& data) const;
+
+  // Returns false if the deadline passed before there was anything to read.
+  // The default implementation polls the native handle, or keeps checking
+  // isReadyForReading if there is none.
+  virtual bool waitForReading(Deadline deadline) const;
+
+  // Returns false if the deadline passed before all data was written, part of
+  // the data might have been written in that case. The default implementation
+  // ignores the deadline.
+  virtual bool writeWithDeadline(
+      const std::string& data,
+      Deadline deadline) const;
+
+  // The underlying system descriptor for use with poll and similar calls, or
+  // -1 if there is none.
+  virtual int getNativeHandle() const;
+
+  // Polls for the given events, returns false if the deadline passes first.
+  static bool waitUntilReady(int fd, short events, Deadline deadline);
+
+  // Milliseconds until the deadline, rounded up, as poll and epoll_wait expect
+  // them. Returns -1 for Deadline::max().
+  static int getPollTimeout(Deadline deadline);
+
 protected:
 
   static bool isReadyForReading(int fd);
 
+  static size_t receiveWithTimestamp(
+      int fd,
+      char* buffer,
+      size_t size,
+      int flags,
+      Timestamp& arrivalTime);
+
 private:
 
   FileDescriptor& operator = (const FileDescriptor&) = delete;
@@ -0,0 +1,124 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_IMPAIRED_FILE_DESCRIPTOR_H_
+#define MARATHON_KIT_CORE_IMPAIRED_FILE_DESCRIPTOR_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "FileDescriptor.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Wraps a real descriptor and simulates a worse network link on top of it,
+// so that protocol strategies can be compared reproducibly on one machine.
+// The same seed always gives the same jitter and reordering. The receiving
+// and the sending side keep separate state, so one thread may read while
+// another one writes. The native handle is not exposed, because its
+// readiness does not account for the simulated delay.
+class ImpairedFileDescriptor : public FileDescriptor {
+public:
+
+  struct Impairment {
+    Impairment();
+
+    // Added to the arrival time of received data. Sent data is not delayed,
+    // so use the whole round trip time here to simulate it.
+    std::chrono::microseconds delay;
+    // Random extra delay of received data, between zero and this value.
+    std::chrono::microseconds jitter;
+    // Caps both directions separately, zero means no cap.
+    uint64_t bitsPerSecond;
+    // Reads return and writes send at most this many bytes at once, zero
+    // means no limit. Only use this with stream descriptors.
+    size_t maxChunkSize;
+    // Probability that a received datagram is held back by the reorder delay,
+    // so that the following ones overtake it. Only use this with message
+    // descriptors.
+    double reorderProbability;
+    std::chrono::microseconds reorderDelay;
+    uint32_t seed;
+  };
+
+  ImpairedFileDescriptor(
+      const std::shared_ptr<FileDescriptor>& fd,
+      const Impairment& impairment);
+
+  virtual bool isReadyForReading() const;
+
+  virtual std::string read() const;
+  virtual void write(const std::string& data) const;
+
+  // Reports the time at which the data arrived over the simulated link.
+  virtual std::string readWithTimestamp(Timestamp& arrivalTime) const;
+
+  virtual bool isEndOfStream(const std::string& data) const;
+
+  virtual bool waitForReading(Deadline deadline) const;
+  virtual bool writeWithDeadline(
+      const std::string& data,
+      Deadline deadline) const;
+
+private:
+
+  ImpairedFileDescriptor(const ImpairedFileDescriptor&) = delete;
+  ImpairedFileDescriptor& operator = (const ImpairedFileDescriptor&) = delete;
+
+  struct Chunk {
+    Chunk(Deadline chunkRelease, const std::string& chunkData);
+
+    Deadline release;
+    std::string data;
+  };
+
+  // Returns true once the first received chunk may be read, or the
+  // connection was closed and there is nothing left.
+  bool waitForRelease(Deadline deadline) const;
+  // Reads once from the wrapped descriptor and schedules the data.
+  void receive() const;
+  Deadline::duration getTransmissionTime(size_t size) const;
+
+  const std::shared_ptr<FileDescriptor> mFd;
+  const Impairment mImpairment;
+
+  // Receiving side, ordered by release time.
+  mutable std::deque<Chunk> mReceived;
+  mutable bool mClosed;
+  mutable Deadline mReceiveLinkFreeAt;
+  mutable Deadline mLastInOrderRelease;
+  mutable std::mt19937 mRandom;
+
+  // Sending side.
+  mutable Deadline mSendLinkFreeAt;
+
+};
+
+}}
+
+#endif
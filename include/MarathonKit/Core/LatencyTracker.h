@@ -0,0 +1,134 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_LATENCY_TRACKER_H_
+#define MARATHON_KIT_CORE_LATENCY_TRACKER_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+#include "SpscQueue.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Measures the round trip time of commands, grouped by command type. The
+// client reports every sent command and every received line, and each line
+// that the matcher accepts as a response completes the oldest command that
+// is still waiting for one. One thread may report sent commands while another
+// one reports received lines. The histograms belong to the receiving side.
+class LatencyTracker {
+public:
+
+  // Round trip times in nanoseconds, bucket i counts the times below 2^i.
+  class Histogram {
+  public:
+
+    static const size_t BUCKET_COUNT = 64;
+
+    Histogram();
+
+    void add(uint64_t nanoseconds);
+
+    uint64_t getCount() const;
+    uint64_t getMin() const;
+    uint64_t getMax() const;
+    double getMean() const;
+    // Upper bound of the bucket that contains the given percentile.
+    uint64_t getPercentile(double percentile) const;
+
+  private:
+
+    std::array<uint64_t, BUCKET_COUNT> mBuckets;
+    uint64_t mCount;
+    uint64_t mSum;
+    uint64_t mMin;
+    uint64_t mMax;
+
+  };
+
+  // Returns the type of a command. The default takes the first word.
+  typedef std::function<std::string(const std::string& command)> Classifier;
+  // Returns whether a received line is a response to a command.
+  typedef std::function<bool(const std::string& line)> Matcher;
+
+  // At most maxPending commands can wait for a response, the others are not
+  // measured.
+  explicit LatencyTracker(size_t maxPending = 1024);
+
+  void setClassifier(const Classifier& classifier);
+  void setMatcher(const Matcher& matcher);
+
+  // Sending side. Every complete line in the sent data counts as one command,
+  // so a command must not be split between several calls.
+  void dataSent(const std::string& data);
+
+  // Receiving side.
+  void lineReceived(const std::string& line);
+  const std::map<std::string, Histogram>& getHistograms() const;
+  // Writes a summary of each command type through Log.
+  void dump() const;
+
+private:
+
+  LatencyTracker(const LatencyTracker&) = delete;
+  LatencyTracker& operator = (const LatencyTracker&) = delete;
+
+  static const size_t MAX_TYPE_LENGTH = 23;
+
+  void commandSent(
+      const char* command,
+      size_t length,
+      std::chrono::steady_clock::time_point sentAt);
+
+  struct Pending {
+    Pending();
+
+    uint64_t sequence;
+    std::chrono::steady_clock::time_point sentAt;
+    uint8_t typeLength;
+    char type[MAX_TYPE_LENGTH];
+  };
+
+  Classifier mClassifier;
+  Matcher mMatcher;
+  SpscQueue<Pending> mPending;
+
+  // Sending side.
+  uint64_t mSentCount;
+
+  // Receiving side.
+  uint64_t mAnsweredCount;
+  std::map<std::string, Histogram> mHistograms;
+  std::string mLastType;
+  Histogram* mLastHistogram;
+
+};
+
+}}
+
+#endif
@@ -27,12 +27,13 @@
 #include <deque>
 #include <memory>
 #include <string>
+#include <utility>
+
+#include "FileDescriptor.h"
 
 namespace MarathonKit {
 namespace Core {
 
-class FileDescriptor;
-
 class LineBuffer {
 public:
 
@@ -52,17 +53,36 @@ public:
   size_t linesReady();
   std::string getLine();
 
+  // Complete lines that are already buffered, never reads anything.
+  size_t linesBuffered() const;
+  // Reads exactly once, blocking if there is nothing to read. For use after
+  // poll or epoll reported the descriptor as readable.
+  void readOnce();
+
+  // Also stores the arrival time of the first byte of the returned line.
+  std::string getLine(FileDescriptor::Timestamp& arrivalTime);
+
+  // Return false if the deadline passes before a char or a whole line is
+  // available.
+  bool getChar(char& ch, FileDescriptor::Deadline deadline);
+  bool getLine(std::string& line, FileDescriptor::Deadline deadline);
+
 private:
 
   LineBuffer(const LineBuffer&) = delete;
   LineBuffer& operator = (const LineBuffer&) = delete;
 
+  bool waitForChars(FileDescriptor::Deadline deadline);
   void loadChars();
+  void consumeChars(size_t count);
 
   std::shared_ptr<FileDescriptor> mFd;
   std::deque<char> mBuffer;
   std::size_t mLinesReady;
 
+  // Unconsumed size and arrival time of each chunk in mBuffer.
+  std::deque<std::pair<size_t, FileDescriptor::Timestamp>> mChunks;
+
 };
 
 void swap(LineBuffer& buffer1, LineBuffer& buffer2);
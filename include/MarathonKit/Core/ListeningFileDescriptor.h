@@ -0,0 +1,70 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_LISTENING_FILE_DESCRIPTOR_H_
+#define MARATHON_KIT_CORE_LISTENING_FILE_DESCRIPTOR_H_
+
+#include <memory>
+#include <string>
+
+#include "FileDescriptor.h"
+#include "StreamFileDescriptor.h"
+
+namespace MarathonKit {
+namespace Core {
+
+class ListeningFileDescriptor {
+public:
+
+  ~ListeningFileDescriptor();
+
+  bool isReadyForAccepting() const;
+  bool waitForAccepting(FileDescriptor::Deadline deadline) const;
+
+  // The accepted connections are non-blocking and close-on-exec.
+  std::unique_ptr<StreamFileDescriptor> accept() const;
+  // Returns nullptr if the deadline passes before a connection arrives.
+  std::unique_ptr<StreamFileDescriptor> accept(
+      FileDescriptor::Deadline deadline) const;
+
+  // The port the socket is bound to, useful after listening on service "0".
+  std::string getLocalService() const;
+
+  static std::unique_ptr<ListeningFileDescriptor> createOwnerOf(int fd);
+  static std::unique_ptr<ListeningFileDescriptor> createCopyOf(int fd);
+
+private:
+
+  ListeningFileDescriptor(int fd);
+
+  ListeningFileDescriptor(const ListeningFileDescriptor&) = delete;
+  ListeningFileDescriptor& operator = (
+      const ListeningFileDescriptor&) = delete;
+
+  const int mFd;
+
+};
+
+}}
+
+#endif
@@ -24,13 +24,24 @@
 #ifndef MARATHON_KIT_CORE_LOG_H_
 #define MARATHON_KIT_CORE_LOG_H_
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
-#include <ctime>
-#include <fstream>
-#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <type_traits>
+
+#include "DeferredArgument.h"
+
+// The LOG and DEBUG macros compile out records below this level together
+// with their arguments. 0 is DEBUG, 1 INFO, 2 WARN, 3 ERR and 4 disables
+// them completely.
+#ifndef MARATHON_KIT_MIN_LOG_LEVEL
+#define MARATHON_KIT_MIN_LOG_LEVEL 0
+#endif
 
 namespace MarathonKit {
 namespace Core {
@@ -45,9 +56,42 @@ public:
     ERR,
   };
 
-  Log(const std::string& file = "", int line = 0):
+  // What happens to a record when the asynchronous queue is full.
+  enum class OverflowPolicy {
+    // Discard the record and count it, the caller never waits.
+    DROP,
+    // Wait until the writer thread makes room.
+    BLOCK,
+  };
+
+  enum class TimestampPrecision {
+    SECONDS,
+    MILLISECONDS,
+    MICROSECONDS,
+  };
+
+  // Where a record comes from. The LOG macros keep a static instance for
+  // every call site, so nothing has to be constructed to log.
+  struct Site {
+    const char* file;
+    int line;
+  };
+
+  // Only keeps the pointer, so the file name must outlive the Log object,
+  // which string literals and __FILE__ always do.
+  Log(const char* file = "", int line = 0):
+    mFile(),
+    mSite{file, line} {}
+  // Keeps a copy of the file name.
+  Log(const std::string& file, int line = 0):
     mFile(file),
-    mLine(line) {}
+    mSite{mFile.c_str(), line} {}
+  Log(const Log& other):
+    mFile(other.mFile),
+    mSite{
+      other.ownsFile() ? mFile.c_str() : other.mSite.file,
+      other.mSite.line
+    } {}
 
   template <typename... Types>
   void d(const Types&... objects) {
@@ -70,58 +114,157 @@ public:
   }
 
   template <typename... Types>
-  void log(Level level, Types... objects) {
-    if (level < getMinLogLevel()) {
-      return;
-    }
-
-    time_t epoch = time(nullptr);
-    struct tm* local = localtime(&epoch);
-    char timeStr[256];
-    if (strftime(timeStr, 256, "%Y-%m-%d %H:%M:%S", local) == 0) {
-      strcpy(timeStr, "?");
+  void log(Level level, const Types&... objects) {
+    if (isEnabled(level)) {
+      logNow(mSite, level, objects...);
     }
+  }
 
-    std::ostringstream outputStream;
-    outputStream << timeStr
-        << ' '
-        << std::setw(5)
-        << mLevelString[static_cast<int>(level)]
-        << ' ';
-
-    if (!mFile.empty()) {
-      outputStream << mFile;
-    } else {
-      outputStream << '?';
-    }
+  // Calls logAt with the objects it is called with.
+  class Writer {
+  public:
 
-    outputStream << ':';
+    Writer(const Site& site, Level level):
+      mSite(site),
+      mLevel(level) {}
 
-    if (mLine > 0) {
-      outputStream << mLine;
-    } else {
-      outputStream << '?';
+    template <typename... Types>
+    void operator() (const Types&... objects) const {
+      logAt(mSite, mLevel, objects...);
     }
 
-    outputStream << '\t';
-    writeObjectsToStream(outputStream, objects...);
-    outputStream << '\n';
+  private:
+
+    const Site& mSite;
+    const Level mLevel;
 
-    std::cerr << outputStream.str();
-    std::cerr.flush();
+  };
 
-    if (mLogFile.is_open()) {
-      mLogFile << outputStream.str();
-      mLogFile.flush();
+  // Used by the LOG macros, the site must have static storage duration.
+  // Does not check the level, callers are expected to do it first.
+  template <typename... Types>
+  static void logAt(const Site& site, Level level, const Types&... objects) {
+    typedef DeferredArguments<Types...> Arguments;
+    if (!logDeferred(
+        std::integral_constant<bool, Arguments::SUPPORTED>(),
+        site,
+        level,
+        objects...)) {
+      logNow(site, level, objects...);
     }
   }
 
+  static bool isEnabled(Level level) {
+    return level >= mMinLogLevel.load(std::memory_order_relaxed);
+  }
+
+  // Lets the compiled out macros keep their arguments referenced.
+  template <typename... Types>
+  static void discard(const Types&...) {}
+
   static void setMinLogLevel(Level level) { mMinLogLevel = level; }
   static Level getMinLogLevel() { return mMinLogLevel; }
+
+  // Safe to call while other threads are logging, the descriptor they write
+  // to is replaced atomically.
   static void setLogFile(const std::string& fileName);
 
+  // Timestamps are taken from the monotonic clock and shifted by the offset
+  // to the system clock measured at the first record. The records of one run
+  // are therefore always ordered, but system clock adjustments made later
+  // are not reflected.
+  static void setTimestampPrecision(TimestampPrecision precision) {
+    mTimestampPrecision = precision;
+  }
+  static TimestampPrecision getTimestampPrecision() {
+    return mTimestampPrecision;
+  }
+
+  // Records are still formatted by the caller, but written by a background
+  // thread in batches. Whatever is queued at exit is written out by a static
+  // destructor. Must not be called while other threads are logging.
+  static void enableAsync(
+      size_t capacity = 8192,
+      OverflowPolicy policy = OverflowPolicy::BLOCK);
+  static void disableAsync();
+
+  // Records logged by the LOG macros whose arguments are only numbers and
+  // strings are not formatted by the caller any more. It copies a pointer to
+  // the call site, a timestamp and the raw values into a buffer of its own
+  // thread and a background thread formats them later. Other records are
+  // formatted immediately, so they may appear out of order with the deferred
+  // ones. Must not be called while other threads are logging.
+  static void enableDeferredFormatting(size_t bufferSizePerThread = 1 << 20);
+  static void disableDeferredFormatting();
+
+  // Blocks until all records logged so far have been written.
+  static void flush();
+  static size_t getDroppedCount();
+
 private:
 
+  typedef const char* (*Decoder)(const char* input, std::ostream& output);
+
+  // Precedes the raw arguments of a deferred record in the staging buffer.
+  struct DeferredRecord {
+    const Site* site;
+    Decoder decoder;
+    std::chrono::steady_clock::time_point time;
+    uint64_t sequenceNumber;
+    uint32_t threadId;
+    uint32_t size;
+    Level level;
+  };
+
+  template <typename... Types>
+  static void logNow(const Site& site, Level level, const Types&... objects) {
+    std::ostream& outputStream = beginRecord(site, level);
+    try {
+      writeObjectsToStream(outputStream, objects...);
+    } catch (...) {
+      abortRecord();
+      throw;
+    }
+    endRecord();
+  }
+
+  template <typename... Types>
+  static bool logDeferred(
+      std::false_type,
+      const Site&,
+      Level,
+      const Types&...) {
+    return false;
+  }
+
+  template <typename... Types>
+  static bool logDeferred(
+      std::true_type,
+      const Site& site,
+      Level level,
+      const Types&... objects) {
+    typedef DeferredArguments<Types...> Arguments;
+    size_t size = sizeof(DeferredRecord) + Arguments::size(objects...);
+    char* output = reserveDeferred(size);
+    if (output == nullptr) {
+      return false;
+    }
+
+    DeferredRecord record = {
+      &site,
+      &Arguments::decode,
+      std::chrono::steady_clock::now(),
+      nextSequenceNumber(),
+      getThreadId(),
+      static_cast<uint32_t>(size),
+      level,
+    };
+    std::memcpy(output, &record, sizeof(record));
+    Arguments::encode(output + sizeof(record), objects...);
+    commitDeferred(size);
+    return true;
+  }
+
   template <typename Type, typename... Types>
   static void writeObjectsToStream(
       std::ostream& outputStream,
@@ -133,12 +276,49 @@ private:
 
   static void writeObjectsToStream(std::ostream&) {}
 
-  std::string mFile;
-  int mLine;
+  static uint64_t nextSequenceNumber() {
+    return mSequenceNumber.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  static uint32_t getThreadId();
+
+  // Formats the record in a buffer of the calling thread. Records logged
+  // while formatting another one (by an output operator) get their own.
+  static std::ostream& beginRecord(const Site& site, Level level);
+  // Writes the record with a single system call per output, so records of
+  // different threads never interleave.
+  static void endRecord();
+  static void abortRecord();
+
+  static void writePrefix(
+      std::ostream& outputStream,
+      const Site& site,
+      Level level,
+      std::chrono::steady_clock::time_point time,
+      uint32_t threadId,
+      uint64_t sequenceNumber);
+  // Returns a per-thread buffer that is overwritten by the next call.
+  static const char* formatTimestamp(
+      std::chrono::steady_clock::time_point time);
+  // Returns nullptr if deferred formatting is disabled or the record is too
+  // large for the staging buffer.
+  static char* reserveDeferred(size_t size);
+  static void commitDeferred(size_t size);
+  // Returns the size of the record.
+  static size_t formatDeferred(const char* input, std::ostream& output);
+  static void writeToOutputs(const char* data, size_t size);
+
+  bool ownsFile() const {
+    return mSite.file == mFile.c_str();
+  }
+
+  const std::string mFile;
+  const Site mSite;
 
-  static Level mMinLogLevel;
+  static std::atomic<Level> mMinLogLevel;
+  static std::atomic<TimestampPrecision> mTimestampPrecision;
+  static std::atomic<uint64_t> mSequenceNumber;
   static char mLevelString[4][10];
-  static std::ofstream mLogFile;
+  static std::atomic<int> mLogFileDescriptor;
 
 };
 
@@ -26,6 +26,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "FileDescriptor.h"
 
@@ -42,6 +43,23 @@ public:
   virtual std::string read() const;
   virtual void write(const std::string& data) const;
 
+  virtual std::string readWithTimestamp(Timestamp& arrivalTime) const;
+
+  // Empty datagrams are valid messages, a read never signals a closed peer.
+  virtual bool isEndOfStream(const std::string& data) const;
+
+  virtual bool waitForReading(Deadline deadline) const;
+  virtual bool writeWithDeadline(
+      const std::string& data,
+      Deadline deadline) const;
+
+  virtual int getNativeHandle() const;
+
+  // Asks the kernel to timestamp incoming data (SO_TIMESTAMPNS), so that
+  // readWithTimestamp reports when the data arrived rather than when it was
+  // read.
+  void enableReceiveTimestamps();
+
   static std::unique_ptr<MessageFileDescriptor> createOwnerOf(int fd);
   static std::unique_ptr<MessageFileDescriptor> createCopyOf(int fd);
 
@@ -52,7 +70,10 @@ private:
   MessageFileDescriptor(const MessageFileDescriptor&) = delete;
   MessageFileDescriptor& operator = (const MessageFileDescriptor&) = delete;
 
+  std::vector<char> createBufferForNextMessage() const;
+
   const int mFd;
+  bool mReceiveTimestamps;
 
 };
 
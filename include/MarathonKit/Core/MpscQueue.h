@@ -0,0 +1,151 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_MPSC_QUEUE_H_
+#define MARATHON_KIT_CORE_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace MarathonKit {
+namespace Core {
+
+// Bounded lock-free queue for any number of producer threads and exactly one
+// consumer thread. Every slot carries a sequence number that tells whose turn
+// it is, so producers only contend on a single compare-and-swap.
+template <typename Type>
+class MpscQueue {
+public:
+
+  // The capacity is rounded up to a power of two.
+  explicit MpscQueue(size_t capacity):
+    mSlots(roundUpToPowerOfTwo(capacity)),
+    mMask(mSlots.size() - 1),
+    mPadding1(),
+    mTail(0),
+    mPadding2(),
+    mHead(0),
+    mPadding3() {
+    for (size_t i = 0; i < mSlots.size(); ++i) {
+      mSlots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Producer side, returns false if the queue is full.
+  bool tryPush(Type&& value) {
+    size_t tail = mTail.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = mSlots[tail & mMask];
+      size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence == tail) {
+        if (mTail.compare_exchange_weak(
+            tail,
+            tail + 1,
+            std::memory_order_relaxed)) {
+          slot.value = std::move(value);
+          slot.sequence.store(tail + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (sequence < tail) {
+        // The consumer has not freed the slot from the previous round yet.
+        return false;
+      } else {
+        tail = mTail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Consumer side, returns false if the queue is empty.
+  bool tryPop(Type& value) {
+    Slot& slot = mSlots[mHead & mMask];
+    if (slot.sequence.load(std::memory_order_acquire) != mHead + 1) {
+      return false;
+    }
+    value = std::move(slot.value);
+    slot.sequence.store(mHead + mSlots.size(), std::memory_order_release);
+    ++mHead;
+    return true;
+  }
+
+  // Consumer side.
+  bool isEmpty() const {
+    const Slot& slot = mSlots[mHead & mMask];
+    return slot.sequence.load(std::memory_order_acquire) != mHead + 1;
+  }
+
+  // The number of pushes that have taken a slot so far. Values are popped in
+  // the same order, but the last few might not be visible to the consumer
+  // yet.
+  size_t getPushCount() const {
+    return mTail.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const {
+    return mSlots.size();
+  }
+
+private:
+
+  static const size_t CACHE_LINE_SIZE = 64;
+
+  struct Slot {
+    Slot():
+      sequence(0),
+      value() {}
+
+    std::atomic<size_t> sequence;
+    Type value;
+  };
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator = (const MpscQueue&) = delete;
+
+  static size_t roundUpToPowerOfTwo(size_t value) {
+    if (value == 0) {
+      throw std::runtime_error("MpscQueue capacity must not be zero");
+    }
+    size_t result = 1;
+    while (result < value) {
+      result *= 2;
+    }
+    return result;
+  }
+
+  std::vector<Slot> mSlots;
+  const size_t mMask;
+
+  // See SpscQueue for the padding.
+  char mPadding1[CACHE_LINE_SIZE];
+  std::atomic<size_t> mTail;
+  char mPadding2[CACHE_LINE_SIZE];
+  size_t mHead;
+  char mPadding3[CACHE_LINE_SIZE];
+
+};
+
+}}
+
+#endif
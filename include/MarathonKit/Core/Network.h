@@ -24,11 +24,15 @@
 #ifndef MARATHON_KIT_CORE_NETWORK_H_
 #define MARATHON_KIT_CORE_NETWORK_H_
 
+#include <sys/socket.h>
+
 #include <memory>
 #include <string>
 
+#include "ListeningFileDescriptor.h"
 #include "StreamFileDescriptor.h"
 #include "MessageFileDescriptor.h"
+#include "SocketOptions.h"
 
 namespace MarathonKit {
 namespace Core {
@@ -55,12 +59,43 @@ public:
     PASSIVE,
   };
 
+  // Returns nullptr if the deadline passes before the connection is
+  // established. Resolving the host is not limited by the deadline, use
+  // prefetch to resolve it in advance. The returned socket is non-blocking.
   static std::unique_ptr<StreamFileDescriptor> createTcpConnection(
       const std::string& host,
-      const std::string& service);
+      const std::string& service,
+      const SocketOptions& options = SocketOptions(),
+      FileDescriptor::Deadline deadline = FileDescriptor::Deadline::max());
 
   static std::unique_ptr<MessageFileDescriptor> createUdpListener(
-      const std::string& service);
+      const std::string& service,
+      const SocketOptions& options = SocketOptions());
+
+  // Accepts both IPv4 and IPv6 connections where the system allows it. Use
+  // the service "0" to listen on a port chosen by the system.
+  static std::unique_ptr<ListeningFileDescriptor> createTcpListener(
+      const std::string& service,
+      int backlog = SOMAXCONN,
+      const SocketOptions& options = SocketOptions());
+
+  // Unix domain sockets for communication between local processes. Paths
+  // starting with '@' are in the abstract namespace and leave no file behind.
+  // Listeners replace a socket file left behind at the path by a process that
+  // is gone, but throw if another listener is still accepting on it.
+  static std::unique_ptr<StreamFileDescriptor> createUnixConnection(
+      const std::string& path);
+  static std::unique_ptr<ListeningFileDescriptor> createUnixListener(
+      const std::string& path,
+      int backlog = SOMAXCONN);
+  static std::unique_ptr<MessageFileDescriptor> createUnixDatagramConnection(
+      const std::string& path);
+  static std::unique_ptr<MessageFileDescriptor> createUnixDatagramListener(
+      const std::string& path);
+
+  // Resolves the host in the background, so that a later createTcpConnection
+  // finds the addresses in the cache of Resolver::getInstance().
+  static void prefetch(const std::string& host, const std::string& service);
 
 };
 
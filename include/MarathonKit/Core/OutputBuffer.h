@@ -0,0 +1,75 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_OUTPUT_BUFFER_H_
+#define MARATHON_KIT_CORE_OUTPUT_BUFFER_H_
+
+#include <cstddef>
+#include <string>
+
+namespace MarathonKit {
+namespace Core {
+
+// Reusable buffer for building outgoing messages without temporary strings.
+// Numbers are formatted without locale, so the decimal point is always '.'.
+// Clearing the buffer keeps its memory for the next message.
+class OutputBuffer {
+public:
+
+  OutputBuffer();
+
+  void clear();
+
+  void append(char ch);
+  void append(const char* str);
+  void append(const char* data, size_t size);
+  void append(const std::string& str);
+
+  void append(int value);
+  void append(long value);
+  void append(long long value);
+  void append(unsigned value);
+  void append(unsigned long value);
+  void append(unsigned long long value);
+
+  // Floating point numbers are written with the fewest digits that still
+  // read back as the same value.
+  void append(float value);
+  void append(double value);
+
+  bool isEmpty() const;
+  size_t getSize() const;
+  const std::string& getData() const;
+
+private:
+
+  void appendSigned(long long value);
+  void appendUnsigned(unsigned long long value);
+
+  std::string mData;
+
+};
+
+}}
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_RECONNECTING_TCP_CLIENT_H_
+#define MARATHON_KIT_CORE_RECONNECTING_TCP_CLIENT_H_
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+
+#include "FileDescriptor.h"
+#include "SocketOptions.h"
+#include "TcpClient.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Line-based client that reconnects when the connection fails and sends the
+// commands that were not answered yet again. Every command is expected to
+// receive exactly one response line. The client connects on first use or
+// when connect is called.
+//
+// connect and getLine block until a connection is established, sleeping
+// through the backoff. sendLine and linesReady never sleep: they make at most
+// one attempt when it is due, which takes at most the connect timeout, and
+// otherwise keep the commands until the client is connected again. A thread
+// driving many clients can watch getNativeHandle and wake up at
+// getNextAttempt to call linesReady.
+class ReconnectingTcpClient {
+public:
+
+  typedef std::function<void(TcpClient& client)> Handshake;
+
+  ReconnectingTcpClient(
+      const std::string& host,
+      const std::string& service,
+      const SocketOptions& options = SocketOptions());
+
+  // Runs after every connection is established, before the unanswered
+  // commands are sent again. The handshake may send and receive on the client
+  // directly. If it throws, the attempt counts as failed.
+  void setHandshake(const Handshake& handshake);
+
+  // The first attempt after a failure is made immediately, the delay before
+  // each further attempt doubles from the initial delay up to the maximum.
+  void setBackoff(
+      std::chrono::milliseconds initialDelay,
+      std::chrono::milliseconds maxDelay);
+  void setConnectTimeout(std::chrono::milliseconds timeout);
+  // Zero means that the client keeps trying forever.
+  void setMaxAttempts(size_t maxAttempts);
+  // sendLine throws if there would be more unanswered commands.
+  void setReplayLimit(size_t replayLimit);
+
+  void connect();
+  bool isConnected() const;
+  // -1 while the client is disconnected.
+  int getNativeHandle() const;
+  // When linesReady or sendLine make the next connection attempt, or
+  // Deadline::max() while the client is connected.
+  FileDescriptor::Deadline getNextAttempt() const;
+
+  void sendLine(const std::string& command);
+  std::string getLine();
+  size_t linesReady();
+
+  size_t getUnansweredCount() const;
+  // The number of connections established so far, including the first one.
+  size_t getConnectionCount() const;
+
+private:
+
+  ReconnectingTcpClient(const ReconnectingTcpClient&) = delete;
+  ReconnectingTcpClient& operator = (const ReconnectingTcpClient&) = delete;
+
+  void disconnect();
+  // Makes a connection attempt if one is due, returns whether the client is
+  // connected.
+  bool reconnectIfDue();
+  bool tryConnect();
+
+  const std::string mHost;
+  const std::string mService;
+  const SocketOptions mOptions;
+  Handshake mHandshake;
+  std::chrono::milliseconds mInitialDelay;
+  std::chrono::milliseconds mMaxDelay;
+  std::chrono::milliseconds mConnectTimeout;
+  size_t mMaxAttempts;
+  size_t mReplayLimit;
+
+  TcpClient mClient;
+  std::deque<std::string> mUnanswered;
+  size_t mConnectionCount;
+  size_t mFailedAttempts;
+  std::chrono::milliseconds mDelay;
+  FileDescriptor::Deadline mNextAttempt;
+
+};
+
+}}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_RECORDING_FILE_DESCRIPTOR_H_
+#define MARATHON_KIT_CORE_RECORDING_FILE_DESCRIPTOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "FileDescriptor.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Passes everything through to another descriptor and appends all data that
+// is read or written to a session log, which ReplayFileDescriptor can play
+// back. One thread may read while another one writes. If appending to the log
+// fails, the error is logged and recording stops, while the wrapped descriptor
+// keeps working.
+class RecordingFileDescriptor : public FileDescriptor {
+public:
+
+  enum class Direction : uint32_t {
+    RECEIVED = 0,
+    SENT = 1
+  };
+
+  // The log starts with this header. All numbers use the byte order of the
+  // machine that made the recording.
+  struct FileHeader {
+    char magic[8];
+    // Start of the recording in nanoseconds since the epoch.
+    int64_t startTime;
+  };
+
+  // Each record consists of this header followed by the data.
+  struct RecordHeader {
+    // Time since the start of the recording.
+    int64_t nanoseconds;
+    uint32_t size;
+    Direction direction;
+  };
+
+  static const char MAGIC[8];
+
+  RecordingFileDescriptor(
+      const std::shared_ptr<FileDescriptor>& fd,
+      const std::string& path);
+  virtual ~RecordingFileDescriptor();
+
+  virtual bool isReadyForReading() const;
+
+  virtual std::string read() const;
+  virtual void write(const std::string& data) const;
+
+  virtual std::string readWithTimestamp(Timestamp& arrivalTime) const;
+  virtual bool isEndOfStream(const std::string& data) const;
+
+  virtual bool waitForReading(Deadline deadline) const;
+  // Data is only recorded if it was written completely before the deadline.
+  virtual bool writeWithDeadline(
+      const std::string& data,
+      Deadline deadline) const;
+
+  virtual int getNativeHandle() const;
+
+private:
+
+  RecordingFileDescriptor(const RecordingFileDescriptor&) = delete;
+  RecordingFileDescriptor& operator = (
+      const RecordingFileDescriptor&) = delete;
+
+  void record(Direction direction, const std::string& data) const;
+
+  const std::shared_ptr<FileDescriptor> mFd;
+  const int mLogFd;
+  const std::chrono::steady_clock::time_point mStart;
+  mutable std::atomic<bool> mRecording;
+
+};
+
+}}
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_REPLAY_FILE_DESCRIPTOR_H_
+#define MARATHON_KIT_CORE_REPLAY_FILE_DESCRIPTOR_H_
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "FileDescriptor.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Plays back the received data from a session log made by
+// RecordingFileDescriptor. Every read returns one recorded chunk, and reads
+// return empty data once the log is exhausted, just like a closed connection.
+// Written data is discarded. The log is mapped into memory, so replaying as
+// fast as possible makes no system calls. There is no native handle
+// (getNativeHandle returns -1), so it cannot be watched by EventLoop or
+// SessionGroup, use waitForReading instead.
+class ReplayFileDescriptor : public FileDescriptor {
+public:
+
+  enum class Pacing {
+    // Each chunk becomes readable at the same time after the construction
+    // of the descriptor as it arrived after the start of the recording.
+    REAL_TIME,
+    AS_FAST_AS_POSSIBLE
+  };
+
+  virtual ~ReplayFileDescriptor();
+
+  virtual bool isReadyForReading() const;
+
+  virtual std::string read() const;
+  virtual void write(const std::string& data) const;
+
+  // Reports the time at which the chunk arrived during the recording.
+  virtual std::string readWithTimestamp(Timestamp& arrivalTime) const;
+
+  virtual bool waitForReading(Deadline deadline) const;
+
+  static std::unique_ptr<ReplayFileDescriptor> createFromFile(
+      const std::string& path,
+      Pacing pacing);
+
+private:
+
+  ReplayFileDescriptor(const char* data, size_t size, Pacing pacing);
+
+  ReplayFileDescriptor(const ReplayFileDescriptor&) = delete;
+  ReplayFileDescriptor& operator = (const ReplayFileDescriptor&) = delete;
+
+  // Skips the sent data, returns false at the end of the log.
+  bool findNextReceived() const;
+  Deadline getReadyTime() const;
+
+  const char* const mData;
+  const size_t mSize;
+  const Pacing mPacing;
+  const Deadline mStart;
+  Timestamp mRecordingStart;
+  mutable size_t mOffset;
+
+};
+
+}}
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_RESOLVER_H_
+#define MARATHON_KIT_CORE_RESOLVER_H_
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace MarathonKit {
+namespace Core {
+
+// Caches the results of getaddrinfo. Successful lookups are kept for
+// getPositiveTimeToLive(), failed lookups for getNegativeTimeToLive().
+// Expired successful lookups are still returned while they are refreshed in
+// the background. The system resolver does not report DNS TTLs, so both
+// durations are fixed.
+class Resolver {
+public:
+
+  struct Query {
+    Query();
+
+    std::string host;
+    std::string service;
+    int family;
+    int socketType;
+    int protocol;
+    int flags;
+
+    bool operator < (const Query& other) const;
+  };
+
+  struct Address {
+    int family;
+    int socketType;
+    int protocol;
+    sockaddr_storage address;
+    socklen_t addressLength;
+
+    const sockaddr* getSockaddr() const;
+  };
+
+  // Returns 0 and fills the addresses or returns a getaddrinfo error code.
+  typedef std::function<int(const Query&, std::vector<Address>&)> Lookup;
+
+  explicit Resolver(const Lookup& lookup = &lookupAddresses);
+  ~Resolver();
+
+  // The process-wide instance used by Network.
+  static Resolver& getInstance();
+
+  std::vector<Address> resolve(const Query& query);
+  void prefetch(const Query& query);
+  // Returns the addresses for the query without looking it up until clear is
+  // called, like an entry in /etc/hosts.
+  void pin(const Query& query, const std::vector<Address>& addresses);
+  void clear();
+
+  void setPositiveTimeToLive(std::chrono::milliseconds timeToLive);
+  std::chrono::milliseconds getPositiveTimeToLive() const;
+  void setNegativeTimeToLive(std::chrono::milliseconds timeToLive);
+  std::chrono::milliseconds getNegativeTimeToLive() const;
+
+  static int lookupAddresses(
+      const Query& query,
+      std::vector<Address>& addresses);
+
+private:
+
+  typedef std::chrono::steady_clock Clock;
+
+  struct Entry {
+    Entry();
+
+    bool pending;
+    int error;
+    std::vector<Address> addresses;
+    Clock::time_point expiration;
+  };
+
+  Resolver(const Resolver&) = delete;
+  Resolver& operator = (const Resolver&) = delete;
+
+  int update(const Query& query, std::vector<Address>& addresses);
+  void scheduleUpdate(const Query& query);
+  void runBackgroundThread();
+
+  const Lookup mLookup;
+
+  mutable std::mutex mMutex;
+  std::condition_variable mEntryUpdated;
+  std::condition_variable mQueueUpdated;
+  std::map<Query, Entry> mEntries;
+  std::deque<Query> mQueue;
+  std::thread mThread;
+  bool mStopping;
+
+  std::chrono::milliseconds mPositiveTimeToLive;
+  std::chrono::milliseconds mNegativeTimeToLive;
+
+};
+
+}}
+
+#endif
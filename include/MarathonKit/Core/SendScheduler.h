@@ -0,0 +1,91 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_SEND_SCHEDULER_H_
+#define MARATHON_KIT_CORE_SEND_SCHEDULER_H_
+
+#include <deque>
+#include <string>
+
+#include "FileDescriptor.h"
+#include "OutputBuffer.h"
+#include "TcpClient.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Token bucket that keeps a client at exactly the allowed command rate. The
+// commands that exceed the rate are queued and released by a timer descriptor
+// at the earliest time the rate allows. Commands released at the same time
+// are sent with a single write. The client must outlive the scheduler and
+// should not be sent to directly while commands are queued.
+class SendScheduler {
+public:
+
+  // Up to burst commands can be sent at once after an idle period.
+  SendScheduler(TcpClient& client, double commandsPerSecond, size_t burst = 1);
+  ~SendScheduler();
+
+  // Sends right away if the rate allows it, otherwise queues the command.
+  void sendLine(const std::string& command);
+
+  // Sends the queued commands whose time has come, without blocking. Returns
+  // the number of sent commands.
+  size_t releaseDue();
+
+  // Blocks until all queued commands are sent. Returns false if the deadline
+  // passes first.
+  bool waitForAll(
+      FileDescriptor::Deadline deadline = FileDescriptor::Deadline::max());
+
+  size_t getQueuedCount() const;
+
+  // Becomes readable when a queued command may be sent, so that the scheduler
+  // can be waited for with poll or an EventLoop. Call releaseDue then.
+  int getNativeHandle() const;
+
+private:
+
+  SendScheduler(const SendScheduler&) = delete;
+  SendScheduler& operator = (const SendScheduler&) = delete;
+
+  // The earliest time at which the next command may be sent.
+  FileDescriptor::Deadline getNextSendTime() const;
+  void takeToken(FileDescriptor::Deadline now);
+  void armTimer();
+
+  TcpClient& mClient;
+  const FileDescriptor::Deadline::duration mInterval;
+  const FileDescriptor::Deadline::duration mTolerance;
+  // When the bucket would be full again, it moves by one interval per
+  // command.
+  FileDescriptor::Deadline mBucketFullAt;
+  std::deque<std::string> mQueue;
+  OutputBuffer mBuffer;
+  const int mTimerFd;
+
+};
+
+}}
+
+#endif
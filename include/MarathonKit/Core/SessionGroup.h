@@ -0,0 +1,86 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_SESSION_GROUP_H_
+#define MARATHON_KIT_CORE_SESSION_GROUP_H_
+
+#include <string>
+#include <vector>
+
+#include "FileDescriptor.h"
+#include "OutputBuffer.h"
+#include "TcpClient.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Owns many clients and waits for all of them at once with epoll, so that
+// a single thread can drive all sessions without polling each of them.
+// Sessions are identified by the index returned from add.
+class SessionGroup {
+public:
+
+  SessionGroup();
+  ~SessionGroup();
+
+  // The client must be connected and must not use a background receiver.
+  size_t add(TcpClient&& client);
+
+  size_t size() const;
+  TcpClient& get(size_t session);
+
+  // True once the connection of the session was closed and all its complete
+  // lines were read.
+  bool isClosed(size_t session) const;
+
+  // Waits until at least one session has a complete line, then returns all
+  // sessions with complete lines. A session whose connection was just closed
+  // is returned once too, its getLine then throws. Returns an empty list if
+  // the deadline passes first. The list is valid until the next call.
+  const std::vector<size_t>& waitForLines(
+      FileDescriptor::Deadline deadline = FileDescriptor::Deadline::max());
+
+  // Sends the same line to all open sessions, the line is formatted only once.
+  void broadcastLine(const std::string& line);
+
+private:
+
+  SessionGroup(const SessionGroup&) = delete;
+  SessionGroup& operator = (const SessionGroup&) = delete;
+
+  // Reads from the sessions that epoll reports as readable.
+  void receive(int timeout);
+  void close(size_t session);
+
+  const int mEpollFd;
+  std::vector<TcpClient> mClients;
+  std::vector<bool> mClosed;
+  std::vector<bool> mJustClosed;
+  std::vector<size_t> mReady;
+  OutputBuffer mBroadcastBuffer;
+
+};
+
+}}
+
+#endif
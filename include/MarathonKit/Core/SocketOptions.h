@@ -0,0 +1,65 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_SOCKET_OPTIONS_H_
+#define MARATHON_KIT_CORE_SOCKET_OPTIONS_H_
+
+namespace MarathonKit {
+namespace Core {
+
+// Tuning applied to sockets created by Network. Zero (or false) keeps the
+// system default for the corresponding option. Options that do not apply to
+// a socket (like TCP_NODELAY for UDP) are ignored.
+struct SocketOptions {
+
+  SocketOptions();
+
+  // Small messages that need to be delivered as soon as possible.
+  static SocketOptions lowLatency();
+  // Large transfers where throughput matters more than latency.
+  static SocketOptions bulkThroughput();
+
+  bool noDelay;
+  // TCP_QUICKACK is not permanent, it is re-armed after every read.
+  bool quickAck;
+  int receiveBufferSize;
+  int sendBufferSize;
+  // SO_BUSY_POLL needs CAP_NET_ADMIN, so none of the presets enable it.
+  int busyPollMicroseconds;
+  // IP_TOS for IPv4 sockets, IPV6_TCLASS for IPv6 sockets.
+  int typeOfService;
+
+  // Lets several listeners share a port, the kernel balances connections
+  // between them.
+  bool reusePort;
+
+  bool keepAlive;
+  int keepAliveIdleSeconds;
+  int keepAliveIntervalSeconds;
+  int keepAliveCount;
+
+};
+
+}}
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_SPSC_QUEUE_H_
+#define MARATHON_KIT_CORE_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace MarathonKit {
+namespace Core {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. All operations are wait-free.
+template <typename Type>
+class SpscQueue {
+public:
+
+  // The capacity is rounded up to a power of two.
+  explicit SpscQueue(size_t capacity):
+    mSlots(roundUpToPowerOfTwo(capacity)),
+    mMask(mSlots.size() - 1),
+    mPadding1(),
+    mHead(0),
+    mCachedTail(0),
+    mPadding2(),
+    mTail(0),
+    mCachedHead(0),
+    mPadding3() {}
+
+  // Producer side, returns false if the queue is full.
+  bool tryPush(Type&& value) {
+    size_t tail = mTail.load(std::memory_order_relaxed);
+    if (tail - mCachedHead == mSlots.size()) {
+      mCachedHead = mHead.load(std::memory_order_acquire);
+      if (tail - mCachedHead == mSlots.size()) {
+        return false;
+      }
+    }
+    mSlots[tail & mMask] = std::move(value);
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side, returns false if the queue is empty.
+  bool tryPop(Type& value) {
+    Type* front = peek();
+    if (front == nullptr) {
+      return false;
+    }
+    value = std::move(*front);
+    mHead.store(
+        mHead.load(std::memory_order_relaxed) + 1,
+        std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side, returns nullptr if the queue is empty.
+  Type* peek() {
+    size_t head = mHead.load(std::memory_order_relaxed);
+    if (head == mCachedTail) {
+      mCachedTail = mTail.load(std::memory_order_acquire);
+      if (head == mCachedTail) {
+        return nullptr;
+      }
+    }
+    return &mSlots[head & mMask];
+  }
+
+  // Exact when called by the consumer, a lower bound for the producer.
+  size_t size() const {
+    size_t tail = mTail.load(std::memory_order_acquire);
+    size_t head = mHead.load(std::memory_order_acquire);
+    return tail - head;
+  }
+
+  size_t capacity() const {
+    return mSlots.size();
+  }
+
+private:
+
+  static const size_t CACHE_LINE_SIZE = 64;
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator = (const SpscQueue&) = delete;
+
+  static size_t roundUpToPowerOfTwo(size_t value) {
+    if (value == 0) {
+      throw std::runtime_error("SpscQueue capacity must not be zero");
+    }
+    size_t result = 1;
+    while (result < value) {
+      result *= 2;
+    }
+    return result;
+  }
+
+  std::vector<Type> mSlots;
+  const size_t mMask;
+
+  // The padding keeps the consumer and the producer indices on separate
+  // cache lines. It is used instead of alignas, because C++11 does not
+  // guarantee over-aligned dynamic allocations.
+  char mPadding1[CACHE_LINE_SIZE];
+  std::atomic<size_t> mHead;
+  size_t mCachedTail;
+  char mPadding2[CACHE_LINE_SIZE];
+  std::atomic<size_t> mTail;
+  size_t mCachedHead;
+  char mPadding3[CACHE_LINE_SIZE];
+
+};
+
+}}
+
+#endif
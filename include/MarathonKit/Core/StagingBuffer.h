@@ -0,0 +1,144 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_STAGING_BUFFER_H_
+#define MARATHON_KIT_CORE_STAGING_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace MarathonKit {
+namespace Core {
+
+// Lock-free ring of bytes for exactly one producer thread and one consumer
+// thread. The producer reserves contiguous space for a variable sized record,
+// fills it in place and commits it. When the end of the ring is too close,
+// the producer wraps around and tells the consumer where the data ends.
+class StagingBuffer {
+public:
+
+  explicit StagingBuffer(size_t capacity):
+    mStorage(checkCapacity(capacity)),
+    mPadding1(),
+    mProducerPosition(0),
+    mEndOfRecordedSpace(capacity),
+    mPadding2(),
+    mConsumerPosition(0),
+    mPadding3() {}
+
+  // Producer side, returns nullptr if there is not enough free space. An
+  // empty buffer always has room for less than half of its capacity, larger
+  // records might never fit.
+  char* reserve(size_t size) {
+    size_t producer = mProducerPosition.load(std::memory_order_relaxed);
+    size_t consumer = mConsumerPosition.load(std::memory_order_acquire);
+
+    // The positions may only be equal when the buffer is empty, so the
+    // producer never fills the last free byte.
+    if (consumer <= producer) {
+      if (mStorage.size() - producer > size) {
+        return &mStorage[producer];
+      }
+      if (consumer > size) {
+        mEndOfRecordedSpace.store(producer, std::memory_order_relaxed);
+        mProducerPosition.store(0, std::memory_order_release);
+        return &mStorage[0];
+      }
+      return nullptr;
+    }
+
+    if (consumer - producer > size) {
+      return &mStorage[producer];
+    }
+    return nullptr;
+  }
+
+  // Producer side, publishes the bytes written after the last reserve.
+  void commit(size_t size) {
+    mProducerPosition.store(
+        mProducerPosition.load(std::memory_order_relaxed) + size,
+        std::memory_order_release);
+  }
+
+  // Consumer side, returns the committed bytes that are contiguous in memory.
+  // The rest (if any) is returned once those are consumed.
+  const char* peek(size_t& size) {
+    size_t consumer = mConsumerPosition.load(std::memory_order_relaxed);
+    size_t producer = mProducerPosition.load(std::memory_order_acquire);
+
+    if (producer < consumer) {
+      size_t end = mEndOfRecordedSpace.load(std::memory_order_relaxed);
+      if (consumer < end) {
+        size = end - consumer;
+        return &mStorage[consumer];
+      }
+      consumer = 0;
+      mConsumerPosition.store(0, std::memory_order_release);
+    }
+
+    size = producer - consumer;
+    return &mStorage[consumer];
+  }
+
+  // Consumer side.
+  void consume(size_t size) {
+    mConsumerPosition.store(
+        mConsumerPosition.load(std::memory_order_relaxed) + size,
+        std::memory_order_release);
+  }
+
+  size_t capacity() const {
+    return mStorage.size();
+  }
+
+private:
+
+  static const size_t CACHE_LINE_SIZE = 64;
+
+  StagingBuffer(const StagingBuffer&) = delete;
+  StagingBuffer& operator = (const StagingBuffer&) = delete;
+
+  static size_t checkCapacity(size_t capacity) {
+    if (capacity == 0) {
+      throw std::runtime_error("StagingBuffer capacity must not be zero");
+    }
+    return capacity;
+  }
+
+  std::vector<char> mStorage;
+
+  // See SpscQueue for the padding.
+  char mPadding1[CACHE_LINE_SIZE];
+  std::atomic<size_t> mProducerPosition;
+  std::atomic<size_t> mEndOfRecordedSpace;
+  char mPadding2[CACHE_LINE_SIZE];
+  std::atomic<size_t> mConsumerPosition;
+  char mPadding3[CACHE_LINE_SIZE];
+
+};
+
+}}
+
+#endif
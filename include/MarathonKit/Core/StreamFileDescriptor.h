@@ -24,6 +24,8 @@
 #ifndef MARATHON_KIT_CORE_STREAM_FILE_DESCRIPTOR_H_
 #define MARATHON_KIT_CORE_STREAM_FILE_DESCRIPTOR_H_
 
+#include <sys/types.h>
+
 #include <memory>
 #include <string>
 
@@ -42,6 +44,23 @@ public:
   virtual std::string read() const;
   virtual void write(const std::string& data) const;
 
+  virtual std::string readWithTimestamp(Timestamp& arrivalTime) const;
+
+  virtual bool waitForReading(Deadline deadline) const;
+  virtual bool writeWithDeadline(
+      const std::string& data,
+      Deadline deadline) const;
+
+  virtual int getNativeHandle() const;
+
+  // Asks the kernel to timestamp incoming data (SO_TIMESTAMPNS), so that
+  // readWithTimestamp reports when the data arrived rather than when it was
+  // read.
+  void enableReceiveTimestamps();
+
+  // Re-arms TCP_QUICKACK after every read, the kernel clears it on its own.
+  void setQuickAck(bool quickAck);
+
   static std::unique_ptr<StreamFileDescriptor> createOwnerOf(int fd);
   static std::unique_ptr<StreamFileDescriptor> createCopyOf(int fd);
 
@@ -52,7 +71,13 @@ private:
   StreamFileDescriptor(const StreamFileDescriptor&) = delete;
   StreamFileDescriptor& operator = (const StreamFileDescriptor&) = delete;
 
+  ssize_t writeSome(const char* buff, size_t size, bool block) const;
+  void rearmQuickAck() const;
+
   const int mFd;
+  bool mIsSocket;
+  bool mReceiveTimestamps;
+  bool mQuickAck;
 
 };
 
@@ -0,0 +1,78 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_TCP_ACCEPTOR_POOL_H_
+#define MARATHON_KIT_CORE_TCP_ACCEPTOR_POOL_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ListeningFileDescriptor.h"
+#include "SocketOptions.h"
+#include "StreamFileDescriptor.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Accepts TCP connections on several threads. Every thread has its own
+// listening socket bound to the same port with SO_REUSEPORT, so the kernel
+// spreads the incoming connections between them. The handler is called on
+// the thread that accepted the connection.
+class TcpAcceptorPool {
+public:
+
+  typedef std::function<void(std::unique_ptr<StreamFileDescriptor>)> Handler;
+
+  TcpAcceptorPool(
+      const std::string& service,
+      size_t threadCount,
+      const Handler& handler,
+      const SocketOptions& options = SocketOptions());
+  ~TcpAcceptorPool();
+
+  // Waits for the handlers that are running to return.
+  void stop();
+
+  std::string getLocalService() const;
+
+private:
+
+  TcpAcceptorPool(const TcpAcceptorPool&) = delete;
+  TcpAcceptorPool& operator = (const TcpAcceptorPool&) = delete;
+
+  void runThread(const ListeningFileDescriptor& listener);
+
+  const Handler mHandler;
+  std::vector<std::unique_ptr<ListeningFileDescriptor>> mListeners;
+  std::vector<std::thread> mThreads;
+  std::atomic<bool> mStopping;
+
+};
+
+}}
+
+#endif
@@ -24,20 +24,44 @@
 #ifndef MARATHON_KIT_CORE_TCP_CLIENT_H_
 #define MARATHON_KIT_CORE_TCP_CLIENT_H_
 
+#include <chrono>
 #include <string>
 #include <memory>
 
+#include "BackgroundReceiver.h"
 #include "FileDescriptor.h"
+#include "LatencyTracker.h"
 #include "LineBuffer.h"
+#include "OutputBuffer.h"
+#include "SocketOptions.h"
 
 namespace MarathonKit {
 namespace Core {
 
+// A client is full-duplex: one thread may send while another thread receives.
+// The send methods only use the descriptor and the send buffer, the receive
+// methods only use the line buffer or the background receiver, so the two
+// sides never share mutable state and need no lock. Sending from several
+// threads at once, receiving from several threads at once, and moving or
+// swapping the client while it is in use are not safe.
 class TcpClient {
 public:
 
   TcpClient();
-  TcpClient(const std::string& host, const std::string& service);
+  // Uses an existing connection, for example one that was accepted by
+  // a ListeningFileDescriptor.
+  explicit TcpClient(const std::shared_ptr<FileDescriptor>& fd);
+  TcpClient(
+      const std::string& host,
+      const std::string& service,
+      const SocketOptions& options = SocketOptions());
+  // The client stays disconnected if the connection is not established
+  // before the timeout.
+  TcpClient(
+      const std::string& host,
+      const std::string& service,
+      std::chrono::milliseconds connectTimeout,
+      const SocketOptions& options = SocketOptions());
 
   TcpClient(TcpClient&& other);
   TcpClient& operator = (TcpClient&& other);
@@ -46,27 +70,83 @@ public:
 
   bool isConnected() const;
 
+  // The descriptor to wait on with poll or an EventLoop, -1 if there is none.
+  int getNativeHandle() const;
+
+  // From now on, lines are read on a dedicated thread. linesReady and getLine
+  // then only take lines from a lock-free queue and never make a system call
+  // while lines are ready. charsReady and getChar are not available in this
+  // mode.
+  void startBackgroundReceiver();
+  bool hasBackgroundReceiver() const;
+
+  // Reports all sent data and all received lines to the tracker, which
+  // measures the round trip time of each command. Pass nullptr to stop.
+  void setLatencyTracker(const std::shared_ptr<LatencyTracker>& tracker);
+
   void sendLine(const std::string& line);
   void sendRaw(const std::string& data);
 
+  // Sends the fields as a single line, separated by spaces. Strings, chars
+  // and numbers are formatted directly into the send buffer.
+  template <typename... Fields>
+  void sendFields(const Fields&... fields);
+
   size_t charsReady();
   size_t linesReady();
 
   char getChar();
   std::string getLine();
 
+  // See LineBuffer, not available with a background receiver.
+  size_t linesBuffered() const;
+  void readOnce();
+
+  // These return false if the deadline passes before the operation finishes.
+  bool sendLine(const std::string& line, FileDescriptor::Deadline deadline);
+  bool sendRaw(const std::string& data, FileDescriptor::Deadline deadline);
+  bool getChar(char& ch, FileDescriptor::Deadline deadline);
+  bool getLine(std::string& line, FileDescriptor::Deadline deadline);
+
 private:
 
   TcpClient(const TcpClient&) = delete;
   TcpClient& operator = (const TcpClient&) = delete;
 
+  void checkNoBackgroundReceiver(const char* function) const;
+
+  void appendFields() {}
+  template <typename Field, typename... Fields>
+  void appendFields(const Field& field, const Fields&... fields);
+
   std::shared_ptr<FileDescriptor> mFd;
+  // Used only by the send side, reused to avoid an allocation per line.
+  OutputBuffer mSendBuffer;
   LineBuffer mLineBuffer;
+  std::unique_ptr<BackgroundReceiver> mReceiver;
+  std::shared_ptr<LatencyTracker> mLatencyTracker;
 
 };
 
 void swap(TcpClient& client1, TcpClient& client2);
 
+template <typename... Fields>
+void TcpClient::sendFields(const Fields&... fields) {
+  mSendBuffer.clear();
+  appendFields(fields...);
+  mSendBuffer.append('\n');
+  sendRaw(mSendBuffer.getData());
+}
+
+template <typename Field, typename... Fields>
+void TcpClient::appendFields(const Field& field, const Fields&... fields) {
+  mSendBuffer.append(field);
+  if (sizeof...(fields) > 0) {
+    mSendBuffer.append(' ');
+  }
+  appendFields(fields...);
+}
+
 }}
 
 #endif
@@ -0,0 +1,106 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_TCP_CLIENT_POOL_H_
+#define MARATHON_KIT_CORE_TCP_CLIENT_POOL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FileDescriptor.h"
+#include "SocketOptions.h"
+#include "TcpClient.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Establishes connections to one server in advance and in parallel, so that
+// taking a ready client from the pool costs no network round trip.
+class TcpClientPool {
+public:
+
+  typedef std::function<void(TcpClient& client)> Handshake;
+
+  TcpClientPool(
+      const std::string& host,
+      const std::string& service,
+      const SocketOptions& options = SocketOptions());
+  // Waits for the connections that are still being established.
+  ~TcpClientPool();
+
+  // Runs on every new connection before it becomes ready. It is called from
+  // several threads at once. If it throws anything, the connection is dropped
+  // and counted as failed.
+  void setHandshake(const Handshake& handshake);
+  void setConnectTimeout(std::chrono::milliseconds timeout);
+
+  // Starts establishing the connections, each on its own thread, and returns
+  // right away.
+  void warmUp(size_t count);
+
+  // Takes a ready client, waiting if the connections are still being
+  // established. Throws if there is none left and none is being established.
+  TcpClient acquire();
+  // Returns false if there is no ready client before the deadline.
+  bool acquire(TcpClient& client, FileDescriptor::Deadline deadline);
+
+  size_t getReadyCount() const;
+  size_t getConnectingCount() const;
+  size_t getFailedCount() const;
+
+private:
+
+  TcpClientPool(const TcpClientPool&) = delete;
+  TcpClientPool& operator = (const TcpClientPool&) = delete;
+
+  void connect();
+  // Joins the connecting threads that are done, so that repeated warmUp calls
+  // do not accumulate them.
+  void joinFinishedThreads();
+
+  const std::string mHost;
+  const std::string mService;
+  const SocketOptions mOptions;
+  Handshake mHandshake;
+  std::chrono::milliseconds mConnectTimeout;
+
+  mutable std::mutex mMutex;
+  std::condition_variable mClientReady;
+  std::deque<TcpClient> mReady;
+  size_t mConnectingCount;
+  size_t mFailedCount;
+  // Only touched by warmUp and the destructor.
+  std::vector<std::thread> mThreads;
+  std::vector<std::thread::id> mFinishedThreads;
+
+};
+
+}}
+
+#endif
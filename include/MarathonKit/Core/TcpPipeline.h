@@ -0,0 +1,91 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CORE_TCP_PIPELINE_H_
+#define MARATHON_KIT_CORE_TCP_PIPELINE_H_
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <string>
+
+#include "FileDescriptor.h"
+#include "TcpClient.h"
+
+namespace MarathonKit {
+namespace Core {
+
+// Sends several commands at once and matches the responses to them in FIFO
+// order, so that K independent commands cost a single round trip. Every
+// command is expected to receive exactly one response line. The client must
+// outlive the pipeline and should not be read from directly while there are
+// pending commands.
+class TcpPipeline {
+public:
+
+  typedef std::function<void(const std::string& response)> Callback;
+
+  explicit TcpPipeline(TcpClient& client);
+
+  void enqueue(const std::string& command, const Callback& callback);
+  // The future becomes ready once processResponses or waitForAll reads the
+  // response, it does not read anything by itself.
+  std::future<std::string> enqueue(const std::string& command);
+
+  // Sends all queued commands with a single write.
+  void flush();
+  // Returns false if the deadline passes before everything is sent. Some of
+  // the commands may have been sent by then, so they all become pending and
+  // the connection should not be used for further commands.
+  bool flush(FileDescriptor::Deadline deadline);
+
+  // Completes the commands whose responses were already received, without
+  // blocking. Returns the number of completed commands.
+  size_t processResponses();
+
+  // Flushes the queue and blocks until all commands are completed.
+  void waitForAll();
+  // Returns false if the deadline passes first.
+  bool waitForAll(FileDescriptor::Deadline deadline);
+
+  size_t getQueuedCount() const;
+  size_t getPendingCount() const;
+
+private:
+
+  TcpPipeline(const TcpPipeline&) = delete;
+  TcpPipeline& operator = (const TcpPipeline&) = delete;
+
+  void markQueuedAsPending();
+  void complete(const std::string& response);
+
+  TcpClient& mClient;
+  std::string mQueuedCommands;
+  std::deque<Callback> mQueuedCallbacks;
+  std::deque<Callback> mPendingCallbacks;
+
+};
+
+}}
+
+#endif
@@ -26,11 +26,29 @@
 
 #include "Core/Log.h"
 
-#define DEBUG(...) ::MarathonKit::DebugMacroImpl::debug( \
-    __FILE__, \
-    __LINE__, \
-    #__VA_ARGS__, \
-    __VA_ARGS__);
+#if MARATHON_KIT_MIN_LOG_LEVEL <= 0
+#define DEBUG(...) \
+  do { \
+    if (::MarathonKit::Core::Log::isEnabled( \
+        ::MarathonKit::Core::Log::Level::DEBUG)) { \
+      static const ::MarathonKit::Core::Log::Site marathonKitDebugSite = { \
+        __FILE__, \
+        __LINE__, \
+      }; \
+      ::MarathonKit::DebugMacroImpl::debug( \
+          marathonKitDebugSite, \
+          #__VA_ARGS__, \
+          __VA_ARGS__); \
+    } \
+  } while (false)
+#else
+#define DEBUG(...) \
+  do { \
+    if (false) { \
+      ::MarathonKit::Core::Log::discard(__VA_ARGS__); \
+    } \
+  } while (false)
+#endif
 
 namespace MarathonKit {
 
@@ -41,15 +59,14 @@ public:
 
   template <typename... Types>
   static void debug(
-      const std::string& file,
-      int line,
-      const std::string& names,
+      const Core::Log::Site& site,
+      const char* names,
       const Types&... objects) {
     std::ostringstream oss;
     oss << "(" << names << ") = (";
     writeObjectsToStream(oss, objects...);
     oss << ")";
-    Core::Log(file, line).d(oss.str());
+    Core::Log::logAt(site, Core::Log::Level::DEBUG, oss.str());
   }
 
 private:
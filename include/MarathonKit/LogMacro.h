@@ -26,9 +26,60 @@
 
 #include "Core/Log.h"
 
-#define LOGD ::MarathonKit::Core::Log(__FILE__, __LINE__).d
-#define LOGI ::MarathonKit::Core::Log(__FILE__, __LINE__).i
-#define LOGW ::MarathonKit::Core::Log(__FILE__, __LINE__).w
-#define LOGE ::MarathonKit::Core::Log(__FILE__, __LINE__).e
+// The level is checked before anything else is evaluated, so a filtered out
+// record costs a single branch. The objects are passed in their own pair of
+// parentheses, so that the macros also work without any.
+#define MARATHON_KIT_LOG(level, ...) \
+  do { \
+    if (::MarathonKit::Core::Log::isEnabled(level)) { \
+      static const ::MarathonKit::Core::Log::Site marathonKitLogSite = { \
+        __FILE__, \
+        __LINE__, \
+      }; \
+      ::MarathonKit::Core::Log::Writer(marathonKitLogSite, level)( \
+          __VA_ARGS__); \
+    } \
+  } while (false)
+
+// The arguments are never evaluated, but stay referenced so that variables
+// used only for logging do not cause warnings.
+#define MARATHON_KIT_LOG_DISABLED(...) \
+  do { \
+    if (false) { \
+      ::MarathonKit::Core::Log::discard(__VA_ARGS__); \
+    } \
+  } while (false)
+
+#if MARATHON_KIT_MIN_LOG_LEVEL <= 0
+#define LOGD(...) MARATHON_KIT_LOG( \
+    ::MarathonKit::Core::Log::Level::DEBUG, \
+    __VA_ARGS__)
+#else
+#define LOGD(...) MARATHON_KIT_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if MARATHON_KIT_MIN_LOG_LEVEL <= 1
+#define LOGI(...) MARATHON_KIT_LOG( \
+    ::MarathonKit::Core::Log::Level::INFO, \
+    __VA_ARGS__)
+#else
+#define LOGI(...) MARATHON_KIT_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if MARATHON_KIT_MIN_LOG_LEVEL <= 2
+#define LOGW(...) MARATHON_KIT_LOG( \
+    ::MarathonKit::Core::Log::Level::WARN, \
+    __VA_ARGS__)
+#else
+#define LOGW(...) MARATHON_KIT_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if MARATHON_KIT_MIN_LOG_LEVEL <= 3
+#define LOGE(...) MARATHON_KIT_LOG( \
+    ::MarathonKit::Core::Log::Level::ERR, \
+    __VA_ARGS__)
+#else
+#define LOGE(...) MARATHON_KIT_LOG_DISABLED(__VA_ARGS__)
+#endif
 
 #endif
@@ -0,0 +1,131 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <utility>
+
+#include "Core/AsyncLogWriter.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+
+// Records are concatenated until the batch reaches this size.
+static const size_t MAX_BATCH_SIZE = 64 * 1024;
+// Guards against a lost wake-up, the writer never sleeps longer than this.
+static const std::chrono::milliseconds IDLE_CHECK_INTERVAL(100);
+
+AsyncLogWriter::AsyncLogWriter(
+    size_t capacity,
+    Log::OverflowPolicy policy,
+    Output output):
+  mQueue(capacity),
+  mPolicy(policy),
+  mOutput(std::move(output)),
+  mWrittenCount(0),
+  mDroppedCount(0),
+  mStopping(false),
+  mMutex(),
+  mRecordAvailable(),
+  mBatchWritten(),
+  mWriterWaiting(false),
+  mThread() {
+  mThread = std::thread(&AsyncLogWriter::run, this);
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+  mStopping = true;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRecordAvailable.notify_one();
+  }
+  mThread.join();
+}
+
+void AsyncLogWriter::push(string&& record) {
+  while (!mQueue.tryPush(std::move(record))) {
+    if (mPolicy == Log::OverflowPolicy::DROP) {
+      ++mDroppedCount;
+      return;
+    }
+    std::this_thread::yield();
+  }
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (mWriterWaiting) {
+    wakeWriter();
+  }
+}
+
+void AsyncLogWriter::flush() {
+  // Includes records of other threads that are still being pushed, but the
+  // writer waits for them, so that it can keep the order.
+  size_t target = mQueue.getPushCount();
+  std::unique_lock<std::mutex> lock(mMutex);
+  mRecordAvailable.notify_one();
+  mBatchWritten.wait(lock, [this, target] {
+    return mWrittenCount >= target;
+  });
+}
+
+void AsyncLogWriter::run() {
+  string batch;
+  string record;
+
+  while (true) {
+    size_t count = 0;
+    batch.clear();
+    while (batch.size() < MAX_BATCH_SIZE && mQueue.tryPop(record)) {
+      batch += record;
+      ++count;
+    }
+
+    if (count > 0) {
+      mOutput(batch);
+      mWrittenCount += count;
+      std::lock_guard<std::mutex> lock(mMutex);
+      mBatchWritten.notify_all();
+      continue;
+    }
+
+    if (mStopping) {
+      break;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mWriterWaiting = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mQueue.isEmpty() && !mStopping) {
+      mRecordAvailable.wait_for(lock, IDLE_CHECK_INTERVAL);
+    }
+    mWriterWaiting = false;
+  }
+}
+
+void AsyncLogWriter::wakeWriter() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mRecordAvailable.notify_one();
+}
+
+}}
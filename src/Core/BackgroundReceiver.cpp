@@ -0,0 +1,153 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#include "LogMacro.h"
+
+#include "Core/BackgroundReceiver.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+
+static const size_t QUEUE_CAPACITY = 4096;
+// How often the reader thread checks whether it should stop.
+static const std::chrono::milliseconds STOP_CHECK_INTERVAL(100);
+// How many times the consumer polls the queue before it goes to sleep.
+static const int SPIN_COUNT = 1000;
+
+BackgroundReceiver::BackgroundReceiver(LineBuffer&& lineBuffer):
+  mLineBuffer(std::move(lineBuffer)),
+  mQueue(QUEUE_CAPACITY),
+  mStopping(false),
+  mFinished(false),
+  mError(),
+  mMutex(),
+  mLineAvailable(),
+  mConsumerWaiting(false),
+  mThread() {
+  if (!mLineBuffer.isInitialized()) {
+    throw std::runtime_error(
+        "BackgroundReceiver needs an initialized LineBuffer");
+  }
+  mThread = std::thread(&BackgroundReceiver::run, this);
+}
+
+BackgroundReceiver::~BackgroundReceiver() {
+  mStopping = true;
+  mThread.join();
+}
+
+size_t BackgroundReceiver::linesReady() {
+  return mQueue.size();
+}
+
+string BackgroundReceiver::getLine() {
+  string line;
+  getLine(line, FileDescriptor::Deadline::max());
+  return line;
+}
+
+bool BackgroundReceiver::getLine(
+    string& line,
+    FileDescriptor::Deadline deadline) {
+  if (!waitForLine(deadline)) {
+    return false;
+  }
+  mQueue.tryPop(line);
+  return true;
+}
+
+void BackgroundReceiver::run() {
+  try {
+    while (!mStopping) {
+      string line;
+      auto deadline = std::chrono::steady_clock::now() + STOP_CHECK_INTERVAL;
+      if (mLineBuffer.getLine(line, deadline)) {
+        push(std::move(line));
+      }
+    }
+  } catch (...) {
+    mError = std::current_exception();
+  }
+
+  mFinished = true;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (mConsumerWaiting) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLineAvailable.notify_one();
+  }
+}
+
+void BackgroundReceiver::push(string&& line) {
+  while (!mQueue.tryPush(std::move(line))) {
+    // The consumer is falling behind, there is no point in hurrying.
+    if (mStopping) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (mConsumerWaiting) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLineAvailable.notify_one();
+  }
+}
+
+bool BackgroundReceiver::waitForLine(FileDescriptor::Deadline deadline) {
+  for (int i = 0; i < SPIN_COUNT; ++i) {
+    if (mQueue.peek() != nullptr) {
+      return true;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  mConsumerWaiting = true;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  while (mQueue.peek() == nullptr && !mFinished) {
+    if (deadline == FileDescriptor::Deadline::max()) {
+      mLineAvailable.wait(lock);
+    } else if (mLineAvailable.wait_until(lock, deadline) ==
+        std::cv_status::timeout) {
+      break;
+    }
+  }
+  mConsumerWaiting = false;
+
+  if (mQueue.peek() != nullptr) {
+    return true;
+  }
+  if (mFinished) {
+    if (mError != nullptr) {
+      std::rethrow_exception(mError);
+    }
+    throw std::runtime_error("BackgroundReceiver was stopped");
+  }
+  return false;
+}
+
+}}
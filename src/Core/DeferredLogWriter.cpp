@@ -0,0 +1,154 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <sstream>
+#include <utility>
+
+#include "Core/DeferredLogWriter.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+// How long the writer sleeps when it found no records.
+static const std::chrono::milliseconds IDLE_INTERVAL(1);
+
+static std::atomic<uint64_t> nextId(0);
+
+DeferredLogWriter::DeferredLogWriter(
+    size_t bufferSize,
+    Formatter formatter,
+    Output output):
+  mBufferSize(bufferSize),
+  mFormatter(std::move(formatter)),
+  mOutput(std::move(output)),
+  mId(++nextId),
+  mMutex(),
+  mBuffers(),
+  mWakeUp(),
+  mRoundFinished(),
+  mRoundCount(0),
+  mStopping(false),
+  mThread() {
+  mThread = std::thread(&DeferredLogWriter::run, this);
+}
+
+DeferredLogWriter::~DeferredLogWriter() {
+  mStopping = true;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWakeUp.notify_one();
+  }
+  mThread.join();
+}
+
+shared_ptr<StagingBuffer> DeferredLogWriter::addThread() {
+  auto buffer = std::make_shared<StagingBuffer>(mBufferSize);
+  std::lock_guard<std::mutex> lock(mMutex);
+  mBuffers.push_back(buffer);
+  return buffer;
+}
+
+void DeferredLogWriter::flush() {
+  std::unique_lock<std::mutex> lock(mMutex);
+  // The round in progress might have passed some buffers already, so wait
+  // for one that starts after this call.
+  uint64_t target = mRoundCount + 2;
+  mWakeUp.notify_one();
+  mRoundFinished.wait(lock, [this, target] {
+    return mRoundCount >= target;
+  });
+}
+
+void DeferredLogWriter::run() {
+  std::ostringstream outputStream;
+
+  while (true) {
+    bool stopping = mStopping;
+
+    outputStream.str("");
+    for (const shared_ptr<StagingBuffer>& buffer : takeBuffers()) {
+      drain(*buffer, outputStream);
+    }
+    string batch = outputStream.str();
+    if (!batch.empty()) {
+      mOutput(batch);
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    ++mRoundCount;
+    mRoundFinished.notify_all();
+    if (stopping) {
+      break;
+    }
+    if (batch.empty()) {
+      mWakeUp.wait_for(lock, IDLE_INTERVAL);
+    }
+  }
+}
+
+void DeferredLogWriter::drain(
+    StagingBuffer& buffer,
+    std::ostream& outputStream) {
+  while (true) {
+    size_t size;
+    const char* data = buffer.peek(size);
+    if (size == 0) {
+      return;
+    }
+    size_t formatted = 0;
+    while (formatted < size) {
+      formatted += mFormatter(data + formatted, outputStream);
+    }
+    buffer.consume(formatted);
+  }
+}
+
+// Also forgets the buffers whose threads have finished and which were
+// drained in the previous round.
+vector<shared_ptr<StagingBuffer>> DeferredLogWriter::takeBuffers() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (auto it = mBuffers.begin(); it != mBuffers.end();) {
+    if (it->use_count() > 1) {
+      ++it;
+      continue;
+    }
+    // Pairs with the release of the reference by the finished thread, so
+    // that its last commit is visible.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    size_t size;
+    (*it)->peek(size);
+    if (size == 0) {
+      it = mBuffers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return mBuffers;
+}
+
+}}
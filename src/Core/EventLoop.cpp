@@ -0,0 +1,132 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <poll.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Core/EventLoop.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::vector;
+
+EventLoop::EventLoop():
+  mWatches() {}
+
+void EventLoop::watch(int fd, short events, const Callback& callback) {
+  if (fd < 0) {
+    throw std::runtime_error("Invalid descriptor in EventLoop::watch");
+  }
+  mWatches.emplace_back(fd, events, callback);
+}
+
+EventLoop::Watch::Watch(
+    int watchedFd,
+    short watchedEvents,
+    const Callback& watchCallback):
+  fd(watchedFd),
+  events(watchedEvents),
+  callback(watchCallback) {}
+
+bool EventLoop::isEmpty() const {
+  return mWatches.empty();
+}
+
+size_t EventLoop::getWatchCount() const {
+  return mWatches.size();
+}
+
+bool EventLoop::runOnce(FileDescriptor::Deadline deadline) {
+  if (mWatches.empty()) {
+    return false;
+  }
+
+  vector<pollfd> pollFds(mWatches.size());
+  for (size_t i = 0; i < mWatches.size(); ++i) {
+    pollFds[i].fd = mWatches[i].fd;
+    pollFds[i].events = mWatches[i].events;
+    pollFds[i].revents = 0;
+  }
+
+  int rc;
+  while (true) {
+    rc = poll(
+        pollFds.data(),
+        pollFds.size(),
+        FileDescriptor::getPollTimeout(deadline));
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      throw std::runtime_error(std::strerror(errno));
+    }
+    if (rc > 0 || std::chrono::steady_clock::now() >= deadline) {
+      break;
+    }
+  }
+  if (rc == 0) {
+    return false;
+  }
+
+  // The watches are removed before any callback runs, so that the callbacks
+  // can add new watches, even for the same descriptor.
+  vector<Watch> ready;
+  vector<Watch> waiting;
+  for (size_t i = 0; i < mWatches.size(); ++i) {
+    if (pollFds[i].revents != 0) {
+      ready.push_back(std::move(mWatches[i]));
+    } else {
+      waiting.push_back(std::move(mWatches[i]));
+    }
+  }
+  mWatches.swap(waiting);
+
+  size_t next = 0;
+  try {
+    while (next < ready.size()) {
+      ready[next++].callback();
+    }
+  } catch (...) {
+    // The remaining watches did not get to run, keep them for the next call.
+    for (size_t i = next; i < ready.size(); ++i) {
+      mWatches.push_back(std::move(ready[i]));
+    }
+    throw;
+  }
+  return true;
+}
+
+void EventLoop::run() {
+  while (!mWatches.empty()) {
+    runOnce(FileDescriptor::Deadline::max());
+  }
+}
+
+}}
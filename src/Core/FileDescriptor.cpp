@@ -21,13 +21,19 @@
  * from me and not from my employer (Facebook).
  */
 
-#include <sys/select.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
+#include <chrono>
+#include <climits>
 #include <cstring>
 #include <stdexcept>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -38,23 +44,169 @@
 namespace MarathonKit {
 namespace Core {
 
+using std::string;
+
+static FileDescriptor::Timestamp toTimestamp(const struct timespec& ts);
+
+string FileDescriptor::readWithTimestamp(Timestamp& arrivalTime) const {
+  string data = read();
+  arrivalTime = std::chrono::system_clock::now();
+  return data;
+}
+
+bool FileDescriptor::isEndOfStream(const string& data) const {
+  return data.empty();
+}
+
+bool FileDescriptor::waitForReading(Deadline deadline) const {
+  int fd = getNativeHandle();
+  if (fd >= 0) {
+    return waitUntilReady(fd, POLLIN, deadline);
+  }
+  while (!isReadyForReading()) {
+    Deadline now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      return false;
+    }
+    std::this_thread::sleep_until(
+        std::min(deadline, now + std::chrono::milliseconds(1)));
+  }
+  return true;
+}
+
+bool FileDescriptor::writeWithDeadline(const string& data, Deadline) const {
+  write(data);
+  return true;
+}
+
+int FileDescriptor::getNativeHandle() const {
+  return -1;
+}
+
 bool FileDescriptor::isReadyForReading(int fd) {
-  struct timeval timeout;
-  timeout.tv_sec = 0;
-  timeout.tv_usec = 0;
+  pollfd pollFd;
+  pollFd.fd = fd;
+  pollFd.events = POLLIN;
+  pollFd.revents = 0;
 
-  fd_set readFds;
-  FD_ZERO(&readFds);
-  FD_SET(fd, &readFds);
+  int rc = poll(&pollFd, 1, 0);
+  if (rc < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
 
-  int nfds = fd + 1;
+  return pollFd.revents != 0;
+}
 
-  int rc = select(nfds, &readFds, nullptr, nullptr, &timeout);
+bool FileDescriptor::waitUntilReady(int fd, short events, Deadline deadline) {
+  pollfd pollFd;
+  pollFd.fd = fd;
+  pollFd.events = events;
+
+  while (true) {
+    int timeout = getPollTimeout(deadline);
+    pollFd.revents = 0;
+    int rc = poll(&pollFd, 1, timeout);
+    if (rc < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(std::strerror(errno));
+    }
+    if (rc > 0) {
+      return true;
+    }
+    if (timeout >= 0 && std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+  }
+}
+
+int FileDescriptor::getPollTimeout(Deadline deadline) {
+  if (deadline == Deadline::max()) {
+    return -1;
+  }
+  auto remaining = deadline - std::chrono::steady_clock::now();
+  if (remaining < Deadline::duration::zero()) {
+    return 0;
+  }
+  // Round up, so that we do not wake up just before the deadline.
+  auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+      remaining + std::chrono::milliseconds(1) -
+      Deadline::duration(1)).count();
+  return static_cast<int>(std::min<decltype(milliseconds)>(
+      milliseconds,
+      INT_MAX));
+}
+
+size_t FileDescriptor::receiveWithTimestamp(
+    int fd,
+    char* buffer,
+    size_t size,
+    int flags,
+    Timestamp& arrivalTime) {
+  struct iovec iov;
+  iov.iov_base = buffer;
+  iov.iov_len = size;
+
+  // Large enough for both SCM_TIMESTAMPNS and SCM_TIMESTAMPING, the union
+  // aligns the buffer for cmsghdr.
+  union {
+    char buffer[CMSG_SPACE(3 * sizeof(struct timespec))];
+    struct cmsghdr align;
+  } control;
+
+  struct msghdr message;
+  memset(&message, 0, sizeof message);
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control.buffer;
+  message.msg_controllen = sizeof control.buffer;
+
+  ssize_t rc = ::recvmsg(fd, &message, flags);
+  while (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    waitUntilReady(fd, POLLIN, Deadline::max());
+    message.msg_controllen = sizeof control.buffer;
+    rc = ::recvmsg(fd, &message, flags);
+  }
   if (rc < 0) {
     throw std::runtime_error(std::strerror(errno));
   }
 
-  return FD_ISSET(fd, &readFds);
+  bool found = false;
+  // A truncated control message is not parsed, the time at which recvmsg
+  // returned is used instead.
+  if ((message.msg_flags & MSG_CTRUNC) == 0) {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+        cmsg != nullptr;
+        cmsg = CMSG_NXTHDR(&message, cmsg)) {
+      if (cmsg->cmsg_level != SOL_SOCKET) {
+        continue;
+      }
+      if (cmsg->cmsg_type == SCM_TIMESTAMPNS ||
+          cmsg->cmsg_type == SCM_TIMESTAMPING) {
+        // The software timestamp is the first timespec in both cases.
+        struct timespec ts;
+        memcpy(&ts, CMSG_DATA(cmsg), sizeof ts);
+        if (ts.tv_sec != 0 || ts.tv_nsec != 0) {
+          arrivalTime = toTimestamp(ts);
+          found = true;
+        }
+      }
+    }
+  }
+  if (!found) {
+    arrivalTime = std::chrono::system_clock::now();
+  }
+
+  return static_cast<size_t>(rc);
+}
+
+static FileDescriptor::Timestamp toTimestamp(const struct timespec& ts) {
+  auto sinceEpoch =
+      std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+  return FileDescriptor::Timestamp(
+      std::chrono::duration_cast<FileDescriptor::Timestamp::duration>(
+          sinceEpoch));
 }
 
 }}
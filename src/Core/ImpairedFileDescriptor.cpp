@@ -0,0 +1,228 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "Core/ImpairedFileDescriptor.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::shared_ptr;
+using std::string;
+
+ImpairedFileDescriptor::Impairment::Impairment():
+  delay(0),
+  jitter(0),
+  bitsPerSecond(0),
+  maxChunkSize(0),
+  reorderProbability(0.0),
+  reorderDelay(std::chrono::milliseconds(10)),
+  seed(0) {}
+
+ImpairedFileDescriptor::Chunk::Chunk(
+    Deadline chunkRelease,
+    const string& chunkData):
+  release(chunkRelease),
+  data(chunkData) {}
+
+ImpairedFileDescriptor::ImpairedFileDescriptor(
+    const shared_ptr<FileDescriptor>& fd,
+    const Impairment& impairment):
+  mFd(fd),
+  mImpairment(impairment),
+  mReceived(),
+  mClosed(false),
+  mReceiveLinkFreeAt(),
+  mLastInOrderRelease(),
+  mRandom(impairment.seed),
+  mSendLinkFreeAt() {}
+
+bool ImpairedFileDescriptor::isReadyForReading() const {
+  if (!mClosed && mFd->isReadyForReading()) {
+    receive();
+  }
+  if (mReceived.empty()) {
+    return mClosed;
+  }
+  return mReceived.front().release <= std::chrono::steady_clock::now();
+}
+
+string ImpairedFileDescriptor::read() const {
+  Timestamp arrivalTime;
+  return readWithTimestamp(arrivalTime);
+}
+
+void ImpairedFileDescriptor::write(const string& data) const {
+  writeWithDeadline(data, Deadline::max());
+}
+
+string ImpairedFileDescriptor::readWithTimestamp(
+    Timestamp& arrivalTime) const {
+  waitForRelease(Deadline::max());
+  arrivalTime = std::chrono::system_clock::now();
+  if (mReceived.empty()) {
+    return string();
+  }
+
+  Chunk& chunk = mReceived.front();
+  if (mImpairment.maxChunkSize != 0 &&
+      chunk.data.size() > mImpairment.maxChunkSize) {
+    string data = chunk.data.substr(0, mImpairment.maxChunkSize);
+    chunk.data.erase(0, mImpairment.maxChunkSize);
+    return data;
+  }
+  string data = std::move(chunk.data);
+  mReceived.pop_front();
+  return data;
+}
+
+bool ImpairedFileDescriptor::isEndOfStream(const string& data) const {
+  return mFd->isEndOfStream(data);
+}
+
+bool ImpairedFileDescriptor::waitForReading(Deadline deadline) const {
+  return waitForRelease(deadline);
+}
+
+bool ImpairedFileDescriptor::writeWithDeadline(
+    const string& data,
+    Deadline deadline) const {
+  size_t chunkSize = mImpairment.maxChunkSize;
+  if (chunkSize == 0) {
+    chunkSize = data.size();
+  }
+  for (size_t offset = 0; offset < data.size(); offset += chunkSize) {
+    string chunk = data.substr(offset, chunkSize);
+    // Each chunk is handed over once it would have left the simulated link.
+    if (mImpairment.bitsPerSecond != 0) {
+      mSendLinkFreeAt =
+          std::max(mSendLinkFreeAt, std::chrono::steady_clock::now()) +
+          getTransmissionTime(chunk.size());
+      if (mSendLinkFreeAt > deadline) {
+        return false;
+      }
+      std::this_thread::sleep_until(mSendLinkFreeAt);
+    }
+    if (!mFd->writeWithDeadline(chunk, deadline)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ImpairedFileDescriptor::waitForRelease(Deadline deadline) const {
+  while (true) {
+    if (mReceived.empty()) {
+      if (mClosed) {
+        return true;
+      }
+      if (!mFd->waitForReading(deadline)) {
+        return false;
+      }
+      receive();
+      continue;
+    }
+    Deadline release = mReceived.front().release;
+    if (release <= std::chrono::steady_clock::now()) {
+      return true;
+    }
+    // Keeps receiving while waiting, data received later may be released
+    // earlier.
+    Deadline until = std::min(release, deadline);
+    if (mClosed) {
+      std::this_thread::sleep_until(until);
+    } else if (mFd->waitForReading(until)) {
+      receive();
+      continue;
+    }
+    if (until == deadline && deadline < release) {
+      return false;
+    }
+  }
+}
+
+void ImpairedFileDescriptor::receive() const {
+  Timestamp arrivalTime;
+  string data = mFd->readWithTimestamp(arrivalTime);
+  if (mFd->isEndOfStream(data)) {
+    mClosed = true;
+    return;
+  }
+
+  // The data may have waited in the socket for a while, the simulated link
+  // starts carrying it when it actually arrived.
+  Deadline release = std::chrono::steady_clock::now() - std::max(
+      std::chrono::duration_cast<Deadline::duration>(
+          std::chrono::system_clock::now() - arrivalTime),
+      Deadline::duration::zero());
+  if (mImpairment.bitsPerSecond != 0) {
+    mReceiveLinkFreeAt =
+        std::max(mReceiveLinkFreeAt, release) +
+        getTransmissionTime(data.size());
+    release = mReceiveLinkFreeAt;
+  }
+  release += mImpairment.delay;
+  if (mImpairment.jitter.count() > 0) {
+    std::uniform_int_distribution<int64_t> jitter(
+        0,
+        mImpairment.jitter.count());
+    release += std::chrono::microseconds(jitter(mRandom));
+  }
+
+  bool reorder = false;
+  if (mImpairment.reorderProbability > 0.0) {
+    std::bernoulli_distribution distribution(mImpairment.reorderProbability);
+    reorder = distribution(mRandom);
+  }
+  if (reorder) {
+    release += mImpairment.reorderDelay;
+  } else {
+    // Jitter alone must not reorder the data.
+    release = std::max(release, mLastInOrderRelease);
+    mLastInOrderRelease = release;
+  }
+
+  auto position = std::upper_bound(
+      mReceived.begin(),
+      mReceived.end(),
+      release,
+      [](Deadline time, const Chunk& chunk) {
+        return time < chunk.release;
+      });
+  mReceived.insert(position, Chunk(release, data));
+}
+
+FileDescriptor::Deadline::duration
+ImpairedFileDescriptor::getTransmissionTime(size_t size) const {
+  return std::chrono::duration_cast<Deadline::duration>(
+      std::chrono::nanoseconds(
+          static_cast<int64_t>(size * 8 * 1000000000ULL /
+          mImpairment.bitsPerSecond)));
+}
+
+}}
@@ -0,0 +1,219 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "LogMacro.h"
+
+#include "Core/LatencyTracker.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::map;
+using std::string;
+
+static double toMicroseconds(double nanoseconds);
+static double toMicroseconds(uint64_t nanoseconds);
+
+const size_t LatencyTracker::MAX_TYPE_LENGTH;
+
+LatencyTracker::Histogram::Histogram():
+  mBuckets(),
+  mCount(0),
+  mSum(0),
+  mMin(0),
+  mMax(0) {}
+
+void LatencyTracker::Histogram::add(uint64_t nanoseconds) {
+  // The bucket is the number of significant bits.
+  size_t bucket = nanoseconds == 0 ?
+      0 :
+      static_cast<size_t>(64 - __builtin_clzll(nanoseconds));
+  ++mBuckets[std::min(bucket, BUCKET_COUNT - 1)];
+  if (mCount == 0 || nanoseconds < mMin) {
+    mMin = nanoseconds;
+  }
+  mMax = std::max(mMax, nanoseconds);
+  mSum += nanoseconds;
+  ++mCount;
+}
+
+uint64_t LatencyTracker::Histogram::getCount() const {
+  return mCount;
+}
+
+uint64_t LatencyTracker::Histogram::getMin() const {
+  return mMin;
+}
+
+uint64_t LatencyTracker::Histogram::getMax() const {
+  return mMax;
+}
+
+double LatencyTracker::Histogram::getMean() const {
+  if (mCount == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(mSum) / static_cast<double>(mCount);
+}
+
+uint64_t LatencyTracker::Histogram::getPercentile(double percentile) const {
+  uint64_t target = static_cast<uint64_t>(
+      std::ceil(percentile / 100.0 * static_cast<double>(mCount)));
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < BUCKET_COUNT - 1; ++bucket) {
+    seen += mBuckets[bucket];
+    if (seen >= target && seen > 0) {
+      return std::min(uint64_t(1) << bucket, mMax);
+    }
+  }
+  return mMax;
+}
+
+LatencyTracker::Pending::Pending():
+  sequence(0),
+  sentAt(),
+  typeLength(0),
+  type() {}
+
+LatencyTracker::LatencyTracker(size_t maxPending):
+  mClassifier(),
+  mMatcher(),
+  mPending(maxPending),
+  mSentCount(0),
+  mAnsweredCount(0),
+  mHistograms(),
+  mLastType(),
+  mLastHistogram(nullptr) {}
+
+void LatencyTracker::setClassifier(const Classifier& classifier) {
+  mClassifier = classifier;
+}
+
+void LatencyTracker::setMatcher(const Matcher& matcher) {
+  mMatcher = matcher;
+}
+
+void LatencyTracker::dataSent(const string& data) {
+  auto sentAt = std::chrono::steady_clock::now();
+  size_t begin = 0;
+  while (true) {
+    size_t end = data.find('\n', begin);
+    if (end == string::npos) {
+      return;
+    }
+    commandSent(data.data() + begin, end - begin, sentAt);
+    begin = end + 1;
+  }
+}
+
+void LatencyTracker::lineReceived(const string& line) {
+  if (mMatcher && !mMatcher(line)) {
+    return;
+  }
+  uint64_t sequence = mAnsweredCount++;
+  Pending* pending = mPending.peek();
+  while (pending != nullptr && pending->sequence < sequence) {
+    Pending stale;
+    mPending.tryPop(stale);
+    pending = mPending.peek();
+  }
+  if (pending == nullptr || pending->sequence != sequence) {
+    // The command did not fit into the queue when it was sent.
+    return;
+  }
+  auto rtt = std::chrono::steady_clock::now() - pending->sentAt;
+  // Consecutive commands often have the same type, which saves the lookup.
+  if (mLastHistogram == nullptr ||
+      mLastType.compare(0, string::npos, pending->type, pending->typeLength)
+          != 0) {
+    mLastType.assign(pending->type, pending->typeLength);
+    mLastHistogram = &mHistograms[mLastType];
+  }
+  mLastHistogram->add(static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(rtt).count()));
+  Pending consumed;
+  mPending.tryPop(consumed);
+}
+
+const map<string, LatencyTracker::Histogram>&
+LatencyTracker::getHistograms() const {
+  return mHistograms;
+}
+
+void LatencyTracker::dump() const {
+  for (const auto& entry : mHistograms) {
+    const Histogram& histogram = entry.second;
+    LOGI(
+        "Latency of ", entry.first, ": ",
+        histogram.getCount(), " commands, mean ",
+        toMicroseconds(histogram.getMean()), " us, min ",
+        toMicroseconds(histogram.getMin()), " us, p50 < ",
+        toMicroseconds(histogram.getPercentile(50.0)), " us, p99 < ",
+        toMicroseconds(histogram.getPercentile(99.0)), " us, max ",
+        toMicroseconds(histogram.getMax()), " us");
+  }
+}
+
+void LatencyTracker::commandSent(
+    const char* command,
+    size_t length,
+    std::chrono::steady_clock::time_point sentAt) {
+  Pending pending;
+  pending.sequence = mSentCount++;
+  pending.sentAt = sentAt;
+  if (mClassifier) {
+    string type = mClassifier(string(command, length));
+    pending.typeLength = static_cast<uint8_t>(
+        std::min(type.size(), MAX_TYPE_LENGTH));
+    memcpy(pending.type, type.data(), pending.typeLength);
+  } else {
+    const char* space = static_cast<const char*>(
+        memchr(command, ' ', length));
+    size_t typeLength = space == nullptr ?
+        length :
+        static_cast<size_t>(space - command);
+    pending.typeLength = static_cast<uint8_t>(
+        std::min(typeLength, MAX_TYPE_LENGTH));
+    memcpy(pending.type, command, pending.typeLength);
+  }
+  // Commands that do not fit are not measured, their sequence numbers keep
+  // the other ones matched correctly.
+  mPending.tryPush(std::move(pending));
+}
+
+static double toMicroseconds(double nanoseconds) {
+  return nanoseconds / 1000.0;
+}
+
+static double toMicroseconds(uint64_t nanoseconds) {
+  return static_cast<double>(nanoseconds) / 1000.0;
+}
+
+}}
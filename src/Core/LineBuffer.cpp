@@ -38,17 +38,20 @@ using std::swap;
 LineBuffer::LineBuffer():
   mFd(),
   mBuffer(),
-  mLinesReady(0) {}
+  mLinesReady(0),
+  mChunks() {}
 
 LineBuffer::LineBuffer(const shared_ptr<FileDescriptor>& fd):
   mFd(fd),
   mBuffer(),
-  mLinesReady(0) {}
+  mLinesReady(0),
+  mChunks() {}
 
 LineBuffer::LineBuffer(LineBuffer&& other):
   mFd(),
   mBuffer(),
-  mLinesReady(0) {
+  mLinesReady(0),
+  mChunks() {
   swapWith(other);
 }
 
@@ -61,6 +64,7 @@ void LineBuffer::swapWith(LineBuffer& other) {
   swap(mFd, other.mFd);
   swap(mBuffer, other.mBuffer);
   swap(mLinesReady, other.mLinesReady);
+  swap(mChunks, other.mChunks);
 }
 
 bool LineBuffer::isInitialized() const {
@@ -86,6 +90,7 @@ char LineBuffer::getChar() {
   }
   char ch = mBuffer.front();
   mBuffer.pop_front();
+  consumeChars(1);
   if (ch == '\n') {
     --mLinesReady;
   }
@@ -105,10 +110,24 @@ size_t LineBuffer::linesReady() {
   return mLinesReady;
 }
 
+size_t LineBuffer::linesBuffered() const {
+  return mLinesReady;
+}
+
+void LineBuffer::readOnce() {
+  loadChars();
+}
+
 std::string LineBuffer::getLine() {
+  FileDescriptor::Timestamp arrivalTime;
+  return getLine(arrivalTime);
+}
+
+std::string LineBuffer::getLine(FileDescriptor::Timestamp& arrivalTime) {
   while (mLinesReady == 0) {
     loadChars();
   }
+  arrivalTime = mChunks.front().second;
   auto it = mBuffer.begin();
   while (*it != '\n') {
     ++it;
@@ -116,15 +135,56 @@ std::string LineBuffer::getLine() {
   std::string line(mBuffer.begin(), it);
   ++it;
   mBuffer.erase(mBuffer.begin(), it);
+  consumeChars(line.size() + 1);
   --mLinesReady;
   return line;
 }
 
+bool LineBuffer::getChar(char& ch, FileDescriptor::Deadline deadline) {
+  while (mBuffer.empty()) {
+    if (!waitForChars(deadline)) {
+      return false;
+    }
+  }
+  ch = getChar();
+  return true;
+}
+
+bool LineBuffer::getLine(std::string& line, FileDescriptor::Deadline deadline) {
+  while (mLinesReady == 0) {
+    if (!waitForChars(deadline)) {
+      return false;
+    }
+  }
+  line = getLine();
+  return true;
+}
+
+bool LineBuffer::waitForChars(FileDescriptor::Deadline deadline) {
+  if (mFd == nullptr) {
+    throw std::runtime_error("Cannot read from an unitialized LineBuffer");
+  }
+  if (!mFd->waitForReading(deadline)) {
+    return false;
+  }
+  loadChars();
+  return true;
+}
+
 void LineBuffer::loadChars() {
   if (mFd == nullptr) {
     throw std::runtime_error("Cannot read from an unitialized LineBuffer");
   }
-  for (char ch : mFd->read()) {
+  FileDescriptor::Timestamp arrivalTime;
+  std::string data = mFd->readWithTimestamp(arrivalTime);
+  if (mFd->isEndOfStream(data)) {
+    throw std::runtime_error("The connection was closed");
+  }
+  if (data.empty()) {
+    return;
+  }
+  mChunks.emplace_back(data.size(), arrivalTime);
+  for (char ch : data) {
     mBuffer.push_back(ch);
     if (ch == '\n') {
       ++mLinesReady;
@@ -132,6 +192,18 @@ void LineBuffer::loadChars() {
   }
 }
 
+void LineBuffer::consumeChars(size_t count) {
+  while (count > 0) {
+    auto& chunk = mChunks.front();
+    if (chunk.first > count) {
+      chunk.first -= count;
+      return;
+    }
+    count -= chunk.first;
+    mChunks.pop_front();
+  }
+}
+
 void swap(LineBuffer& buffer1, LineBuffer& buffer2) {
   buffer1.swapWith(buffer2);
 }
@@ -0,0 +1,134 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include "LogMacro.h"
+
+#include "Core/ListeningFileDescriptor.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+using std::unique_ptr;
+
+ListeningFileDescriptor::ListeningFileDescriptor(int fd):
+  mFd(fd) {
+  if (fd < 0) {
+    throw std::runtime_error(
+        "Invalid descriptor in ListeningFileDescriptor constructor");
+  }
+}
+
+ListeningFileDescriptor::~ListeningFileDescriptor() {
+  close(mFd);
+}
+
+bool ListeningFileDescriptor::isReadyForAccepting() const {
+  return FileDescriptor::waitUntilReady(
+      mFd,
+      POLLIN,
+      std::chrono::steady_clock::now());
+}
+
+bool ListeningFileDescriptor::waitForAccepting(
+    FileDescriptor::Deadline deadline) const {
+  return FileDescriptor::waitUntilReady(mFd, POLLIN, deadline);
+}
+
+unique_ptr<StreamFileDescriptor> ListeningFileDescriptor::accept() const {
+  return accept(FileDescriptor::Deadline::max());
+}
+
+unique_ptr<StreamFileDescriptor> ListeningFileDescriptor::accept(
+    FileDescriptor::Deadline deadline) const {
+  while (true) {
+    int fd = ::accept4(mFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0) {
+      return StreamFileDescriptor::createOwnerOf(fd);
+    }
+    switch (errno) {
+      case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+      case EWOULDBLOCK:
+#endif
+        if (!waitForAccepting(deadline)) {
+          return nullptr;
+        }
+        break;
+      case EINTR:
+      case ECONNABORTED:
+        // The connection went away before we accepted it, try the next one.
+        break;
+      default:
+        throw std::runtime_error(std::strerror(errno));
+    }
+  }
+}
+
+string ListeningFileDescriptor::getLocalService() const {
+  sockaddr_storage address;
+  socklen_t addressLength = sizeof address;
+  int rc = getsockname(
+      mFd,
+      reinterpret_cast<sockaddr*>(&address),
+      &addressLength);
+  if (rc != 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  switch (address.ss_family) {
+    case AF_INET:
+      return std::to_string(ntohs(
+          reinterpret_cast<sockaddr_in*>(&address)->sin_port));
+    case AF_INET6:
+      return std::to_string(ntohs(
+          reinterpret_cast<sockaddr_in6*>(&address)->sin6_port));
+  }
+  throw std::runtime_error("The socket is not bound to an IP address");
+}
+
+unique_ptr<ListeningFileDescriptor> ListeningFileDescriptor::createOwnerOf(
+    int fd) {
+  return unique_ptr<ListeningFileDescriptor>(new ListeningFileDescriptor(fd));
+}
+
+unique_ptr<ListeningFileDescriptor> ListeningFileDescriptor::createCopyOf(
+    int fd) {
+  int fdCopy = dup(fd);
+  if (fdCopy < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  return unique_ptr<ListeningFileDescriptor>(
+      new ListeningFileDescriptor(fdCopy));
+}
+
+}}
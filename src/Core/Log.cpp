@@ -21,14 +21,136 @@
  * from me and not from my employer (Facebook).
  */
 
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <streambuf>
 #include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Core/AsyncLogWriter.h"
+#include "Core/DeferredLogWriter.h"
+#include "Core/StagingBuffer.h"
 
 #include "Core/Log.h"
 
 namespace MarathonKit {
 namespace Core {
 
-Log::Level Log::mMinLogLevel = Log::Level::DEBUG;
+using std::string;
+
+static std::chrono::nanoseconds getSystemClockOffset();
+static void writeDigits(char* buffer, uint32_t value, int count);
+static void writeAll(int fd, const char* data, size_t size);
+
+// Destroying it at exit writes out the records that are still queued.
+template <typename Writer>
+class LogWriterOwner {
+public:
+
+  LogWriterOwner():
+    mWriter(nullptr) {}
+
+  ~LogWriterOwner() {
+    reset(nullptr);
+  }
+
+  Writer* get() const {
+    return mWriter.load(std::memory_order_acquire);
+  }
+
+  void reset(Writer* writer) {
+    std::unique_ptr<Writer> old(mWriter.exchange(writer));
+  }
+
+private:
+
+  std::atomic<Writer*> mWriter;
+
+};
+
+// The staging buffer of a thread, valid while the writer it was created by
+// is the current one.
+struct ThreadStagingBuffer {
+  ThreadStagingBuffer():
+    buffer(),
+    writerId(0) {}
+
+  std::shared_ptr<StagingBuffer> buffer;
+  uint64_t writerId;
+};
+
+// Keeps its storage between records, so that formatting a record does not
+// allocate once the buffer has grown large enough.
+class RecordBuffer : public std::streambuf {
+public:
+
+  RecordBuffer():
+    std::streambuf(),
+    mData(INITIAL_SIZE, '\0') {
+    reset();
+  }
+
+  void reset() {
+    setp(&mData[0], &mData[0] + mData.size());
+  }
+
+  const char* data() const { return pbase(); }
+  size_t size() const { return static_cast<size_t>(pptr() - pbase()); }
+
+protected:
+
+  virtual int_type overflow(int_type character) override {
+    if (traits_type::eq_int_type(character, traits_type::eof())) {
+      return traits_type::not_eof(character);
+    }
+    size_t used = size();
+    mData.resize(mData.size() * 2);
+    setp(&mData[0], &mData[0] + mData.size());
+    pbump(static_cast<int>(used));
+    *pptr() = traits_type::to_char_type(character);
+    pbump(1);
+    return character;
+  }
+
+private:
+
+  static const size_t INITIAL_SIZE = 256;
+
+  std::string mData;
+
+};
+
+struct RecordStream {
+  RecordStream():
+    buffer(),
+    stream(&buffer),
+    defaultFlags(stream.flags()) {}
+
+  RecordBuffer buffer;
+  std::ostream stream;
+  const std::ios_base::fmtflags defaultFlags;
+};
+
+static LogWriterOwner<AsyncLogWriter> asyncLogWriter;
+static LogWriterOwner<DeferredLogWriter> deferredLogWriter;
+static thread_local ThreadStagingBuffer threadStagingBuffer;
+static thread_local std::vector<std::unique_ptr<RecordStream>> recordStreams;
+static thread_local size_t recordDepth = 0;
+
+std::atomic<Log::Level> Log::mMinLogLevel(Log::Level::DEBUG);
 
 char Log::mLevelString[4][10] = {
   "DEBUG",
@@ -37,15 +159,299 @@ char Log::mLevelString[4][10] = {
   "ERR",
 };
 
-std::ofstream Log::mLogFile;
+std::atomic<Log::TimestampPrecision> Log::mTimestampPrecision(
+    Log::TimestampPrecision::SECONDS);
+
+std::atomic<uint64_t> Log::mSequenceNumber(0);
 
-void Log::setLogFile(const std::string& fileName) {
-  mLogFile.clear();
-  mLogFile.open(fileName, std::fstream::app);
+std::atomic<int> Log::mLogFileDescriptor(-1);
 
-  if (mLogFile.fail()) {
+void Log::setLogFile(const string& fileName) {
+  int fd = open(
+      fileName.c_str(),
+      O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+      0666);
+
+  if (fd < 0) {
     throw std::runtime_error("Could not open the log file");
   }
+
+  int current = mLogFileDescriptor;
+  if (current < 0) {
+    mLogFileDescriptor = fd;
+    return;
+  }
+
+  // Other threads keep writing to the same descriptor number, which now
+  // refers to the new file.
+  if (dup2(fd, current) < 0) {
+    close(fd);
+    throw std::runtime_error("Could not open the log file");
+  }
+  close(fd);
+}
+
+void Log::enableAsync(size_t capacity, OverflowPolicy policy) {
+  asyncLogWriter.reset(new AsyncLogWriter(
+      capacity,
+      policy,
+      [](const string& batch) {
+        writeToOutputs(batch.data(), batch.size());
+      }));
+}
+
+void Log::disableAsync() {
+  asyncLogWriter.reset(nullptr);
+}
+
+void Log::enableDeferredFormatting(size_t bufferSizePerThread) {
+  deferredLogWriter.reset(new DeferredLogWriter(
+      bufferSizePerThread,
+      formatDeferred,
+      [](const string& batch) {
+        writeToOutputs(batch.data(), batch.size());
+      }));
+}
+
+void Log::disableDeferredFormatting() {
+  deferredLogWriter.reset(nullptr);
+}
+
+void Log::flush() {
+  DeferredLogWriter* deferredWriter = deferredLogWriter.get();
+  if (deferredWriter != nullptr) {
+    deferredWriter->flush();
+  }
+  AsyncLogWriter* asyncWriter = asyncLogWriter.get();
+  if (asyncWriter != nullptr) {
+    asyncWriter->flush();
+  }
+}
+
+size_t Log::getDroppedCount() {
+  AsyncLogWriter* writer = asyncLogWriter.get();
+  return writer != nullptr ? writer->getDroppedCount() : 0;
+}
+
+uint32_t Log::getThreadId() {
+  static thread_local uint32_t threadId =
+      static_cast<uint32_t>(syscall(SYS_gettid));
+  return threadId;
+}
+
+std::ostream& Log::beginRecord(const Site& site, Level level) {
+  if (recordDepth == recordStreams.size()) {
+    recordStreams.emplace_back(new RecordStream());
+  }
+  RecordStream& record = *recordStreams[recordDepth];
+  ++recordDepth;
+
+  record.buffer.reset();
+  record.stream.clear();
+  record.stream.flags(record.defaultFlags);
+  record.stream.precision(6);
+  record.stream.fill(' ');
+  writePrefix(
+      record.stream,
+      site,
+      level,
+      std::chrono::steady_clock::now(),
+      getThreadId(),
+      nextSequenceNumber());
+  return record.stream;
+}
+
+void Log::endRecord() {
+  --recordDepth;
+  RecordStream& record = *recordStreams[recordDepth];
+  record.stream << '\n';
+
+  AsyncLogWriter* writer = asyncLogWriter.get();
+  if (writer != nullptr) {
+    writer->push(string(record.buffer.data(), record.buffer.size()));
+  } else {
+    writeToOutputs(record.buffer.data(), record.buffer.size());
+  }
+}
+
+void Log::abortRecord() {
+  --recordDepth;
+}
+
+void Log::writePrefix(
+    std::ostream& outputStream,
+    const Site& site,
+    Level level,
+    std::chrono::steady_clock::time_point time,
+    uint32_t threadId,
+    uint64_t sequenceNumber) {
+  outputStream << formatTimestamp(time)
+      << ' '
+      << std::setw(5)
+      << mLevelString[static_cast<int>(level)]
+      << ' '
+      << threadId
+      << " #"
+      << sequenceNumber
+      << ' ';
+
+  if (site.file != nullptr && site.file[0] != '\0') {
+    outputStream << site.file;
+  } else {
+    outputStream << '?';
+  }
+
+  outputStream << ':';
+
+  if (site.line > 0) {
+    outputStream << site.line;
+  } else {
+    outputStream << '?';
+  }
+
+  outputStream << '\t';
+}
+
+// The date and time part only changes once a second, so every thread keeps it
+// formatted and only appends the fraction.
+const char* Log::formatTimestamp(std::chrono::steady_clock::time_point time) {
+  static const size_t BUFFER_SIZE = 64;
+  static thread_local time_t cachedSecond = -1;
+  static thread_local size_t cachedLength = 0;
+  static thread_local char buffer[BUFFER_SIZE];
+
+  auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+      time.time_since_epoch() +
+      getSystemClockOffset()).count();
+  time_t second = static_cast<time_t>(now / 1000000);
+  uint32_t microsecond = static_cast<uint32_t>(now % 1000000);
+
+  if (second != cachedSecond) {
+    struct tm local;
+    cachedLength = 0;
+    if (localtime_r(&second, &local) != nullptr) {
+      cachedLength = strftime(
+          buffer,
+          BUFFER_SIZE,
+          "%Y-%m-%d %H:%M:%S",
+          &local);
+    }
+    if (cachedLength == 0) {
+      std::strcpy(buffer, "?");
+      cachedLength = 1;
+    }
+    cachedSecond = second;
+  }
+
+  char* end = buffer + cachedLength;
+  switch (mTimestampPrecision) {
+    case TimestampPrecision::SECONDS:
+      break;
+    case TimestampPrecision::MILLISECONDS:
+      *end++ = '.';
+      writeDigits(end, microsecond / 1000, 3);
+      end += 3;
+      break;
+    case TimestampPrecision::MICROSECONDS:
+      *end++ = '.';
+      writeDigits(end, microsecond, 6);
+      end += 6;
+      break;
+  }
+  *end = '\0';
+  return buffer;
+}
+
+char* Log::reserveDeferred(size_t size) {
+  DeferredLogWriter* writer = deferredLogWriter.get();
+  // See StagingBuffer::reserve, an empty buffer only guarantees room for
+  // records smaller than half of it.
+  if (writer == nullptr || size >= writer->getBufferSize() / 2) {
+    return nullptr;
+  }
+
+  ThreadStagingBuffer& local = threadStagingBuffer;
+  if (local.writerId != writer->getId()) {
+    local.buffer = writer->addThread();
+    local.writerId = writer->getId();
+  }
+
+  while (true) {
+    char* output = local.buffer->reserve(size);
+    if (output != nullptr) {
+      return output;
+    }
+    std::this_thread::yield();
+  }
+}
+
+void Log::commitDeferred(size_t size) {
+  threadStagingBuffer.buffer->commit(size);
+}
+
+size_t Log::formatDeferred(const char* input, std::ostream& outputStream) {
+  DeferredRecord record = {
+    nullptr,
+    nullptr,
+    std::chrono::steady_clock::time_point(),
+    0,
+    0,
+    0,
+    Level::DEBUG,
+  };
+  std::memcpy(&record, input, sizeof(record));
+  writePrefix(
+      outputStream,
+      *record.site,
+      record.level,
+      record.time,
+      record.threadId,
+      record.sequenceNumber);
+  record.decoder(input + sizeof(record), outputStream);
+  outputStream << '\n';
+  return record.size;
+}
+
+void Log::writeToOutputs(const char* data, size_t size) {
+  writeAll(STDERR_FILENO, data, size);
+  int logFileDescriptor = mLogFileDescriptor;
+  if (logFileDescriptor >= 0) {
+    writeAll(logFileDescriptor, data, size);
+  }
+}
+
+// The difference between the system clock and the monotonic clock, measured
+// once, so that all timestamps are taken from the monotonic clock.
+static std::chrono::nanoseconds getSystemClockOffset() {
+  static const std::chrono::nanoseconds offset =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch()) -
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch());
+  return offset;
+}
+
+// Writes exactly count digits, with leading zeros.
+static void writeDigits(char* buffer, uint32_t value, int count) {
+  for (int i = count - 1; i >= 0; --i) {
+    buffer[i] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+}
+
+// Logging must not throw, so errors other than interruptions drop the rest.
+static void writeAll(int fd, const char* data, size_t size) {
+  size_t written = 0;
+  while (written < size) {
+    ssize_t result = ::write(fd, data + written, size - written);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    written += static_cast<size_t>(result);
+  }
 }
 
 }}
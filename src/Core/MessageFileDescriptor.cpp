@@ -21,7 +21,7 @@
  * from me and not from my employer (Facebook).
  */
 
-#include <sys/select.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -42,7 +42,8 @@ using std::string;
 using std::unique_ptr;
 
 MessageFileDescriptor::MessageFileDescriptor(int fd):
-  mFd(fd) {
+  mFd(fd),
+  mReceiveTimestamps(false) {
   if (fd < 0) {
     throw std::runtime_error(
         "Invalid descriptor in MessageFileDescriptor constructor");
@@ -57,11 +58,86 @@ bool MessageFileDescriptor::isReadyForReading() const {
   return FileDescriptor::isReadyForReading(mFd);
 }
 
+int MessageFileDescriptor::getNativeHandle() const {
+  return mFd;
+}
+
 string MessageFileDescriptor::read() const {
+  std::vector<char> buffer = createBufferForNextMessage();
+  ssize_t rc = ::recv(mFd, buffer.data(), buffer.size(), 0);
+  if (rc < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  return string(buffer.data(), static_cast<size_t>(rc));
+}
+
+string MessageFileDescriptor::readWithTimestamp(Timestamp& arrivalTime) const {
+  if (!mReceiveTimestamps) {
+    return FileDescriptor::readWithTimestamp(arrivalTime);
+  }
+  std::vector<char> buffer = createBufferForNextMessage();
+  size_t size = receiveWithTimestamp(
+      mFd,
+      buffer.data(),
+      buffer.size(),
+      0,
+      arrivalTime);
+  return string(buffer.data(), size);
+}
+
+void MessageFileDescriptor::write(const string& data) const {
+  writeWithDeadline(data, Deadline::max());
+}
+
+bool MessageFileDescriptor::isEndOfStream(const string&) const {
+  return false;
+}
+
+bool MessageFileDescriptor::waitForReading(Deadline deadline) const {
+  return waitUntilReady(mFd, POLLIN, deadline);
+}
+
+bool MessageFileDescriptor::writeWithDeadline(
+    const string& data,
+    Deadline deadline) const {
+  // Writes with a deadline must not block even if the socket is blocking.
+  int flags = deadline == Deadline::max() ? 0 : MSG_DONTWAIT;
+  ssize_t rc = ::send(mFd, data.c_str(), data.size(), flags);
+  while (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    if (!waitUntilReady(mFd, POLLOUT, deadline)) {
+      return false;
+    }
+    rc = ::send(mFd, data.c_str(), data.size(), flags);
+  }
+  if (rc < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  return true;
+}
+
+void MessageFileDescriptor::enableReceiveTimestamps() {
+  int enable = 1;
+  int rc = setsockopt(
+      mFd,
+      SOL_SOCKET,
+      SO_TIMESTAMPNS,
+      &enable,
+      sizeof enable);
+  if (rc != 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  mReceiveTimestamps = true;
+}
+
+std::vector<char> MessageFileDescriptor::createBufferForNextMessage() const {
   std::vector<char> buffer(32, '\0');
   bool enoughSpace = false;
   while (!enoughSpace) {
     ssize_t rc = ::recv(mFd, buffer.data(), buffer.size(), MSG_PEEK);
+    if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      waitUntilReady(mFd, POLLIN, Deadline::max());
+      continue;
+    }
     if (rc < 0) {
       throw std::runtime_error(std::strerror(errno));
     }
@@ -71,18 +147,7 @@ string MessageFileDescriptor::read() const {
       buffer = std::vector<char>(4 * buffer.size(), '\0');
     }
   }
-  ssize_t rc = ::recv(mFd, buffer.data(), buffer.size(), 0);
-  if (rc < 0) {
-    throw std::runtime_error(std::strerror(errno));
-  }
-  return string(buffer.data(), static_cast<size_t>(rc));
-}
-
-void MessageFileDescriptor::write(const string& data) const {
-  ssize_t rc = ::send(mFd, data.c_str(), data.size(), 0);
-  if (rc < 0) {
-    throw std::runtime_error(std::strerror(errno));
-  }
+  return buffer;
 }
 
 unique_ptr<MessageFileDescriptor> MessageFileDescriptor::createOwnerOf(int fd) {
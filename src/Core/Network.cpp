@@ -21,18 +21,36 @@
  * from me and not from my employer (Facebook).
  */
 
+#include <arpa/inet.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
 #include <cstring>
+#include <deque>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <stdexcept>
+#include <vector>
 
 #include "LogMacro.h"
 
+#include "Core/Resolver.h"
+
 #include "Core/Network.h"
 
 namespace MarathonKit {
@@ -45,68 +63,122 @@ static int getAiSocketType(Network::Protocol protocol);
 static int getAiProtocol(Network::Protocol protocol);
 static int getAiFlags(Network::Mode mode);
 
+static void applySocketOptions(
+    int socketFd,
+    const Resolver::Address& address,
+    const SocketOptions& options);
+static void setSocketOption(
+    int socketFd,
+    int level,
+    int name,
+    int value,
+    const char* optionName);
+
 enum class LoopControl {
   CONTINUE,
   BREAK,
 };
 
+static Resolver::Query createQuery(
+    const std::string& host,
+    const std::string& service,
+    Network::Family family,
+    Network::Protocol protocol,
+    Network::Mode mode);
+
 static void forEachAddressInfo(
     const std::string& host,
     const std::string& service,
     Network::Family family,
     Network::Protocol protocol,
     Network::Mode mode,
-    std::function<LoopControl(const addrinfo*)> callback);
+    std::function<LoopControl(const Resolver::Address&)> callback);
+
+// Delay between starting two connection attempts, as recommended by
+// RFC 8305 (Happy Eyeballs Version 2).
+static const std::chrono::milliseconds CONNECTION_ATTEMPT_DELAY(250);
+
+static std::mutex preferredFamiliesMutex;
+static std::map<std::string, int> preferredFamilies;
+
+static int getPreferredFamily(const std::string& host);
+static void setPreferredFamily(const std::string& host, int family);
+
+static std::vector<Resolver::Address> interleaveFamilies(
+    const std::vector<Resolver::Address>& addresses,
+    int firstFamily);
+static int connectToAny(
+    const std::vector<Resolver::Address>& addresses,
+    const SocketOptions& options,
+    FileDescriptor::Deadline deadline,
+    size_t& addressIndex,
+    bool& timedOut);
+static int startConnecting(
+    const Resolver::Address& address,
+    const SocketOptions& options,
+    bool& connected);
+static std::string formatAddress(const Resolver::Address& address);
+
+static int createUnixSocket(int type, const std::string& path);
+static socklen_t createUnixAddress(
+    const std::string& path,
+    sockaddr_un& address);
+static void bindUnixSocket(int socketFd, const std::string& path);
+static bool isUnixSocketAlive(
+    const sockaddr_un& address,
+    socklen_t addressLength);
+static void connectUnixSocket(int socketFd, const std::string& path);
 
 unique_ptr<StreamFileDescriptor> Network::createTcpConnection(
   const std::string& host,
-  const std::string& service) {
+  const std::string& service,
+  const SocketOptions& options,
+  FileDescriptor::Deadline deadline) {
   LOGI("Trying to connect to ", host, ":", service, " using TCP...");
-  unique_ptr<StreamFileDescriptor> fd;
-  bool anyTried = false;
-  forEachAddressInfo(
-      host,
-      service,
-      Network::Family::ANY,
-      Network::Protocol::TCP,
-      Network::Mode::ACTIVE,
-      [host, service, &fd, &anyTried](const addrinfo* info) -> LoopControl {
-        anyTried = true;
-        int socketFd = socket(
-            info->ai_family,
-            info->ai_socktype,
-            info->ai_protocol);
-        if (socketFd < 0) {
-          // TODO: use inet_ntop and print the actual address
-          LOGW(
-              "Connection attempt to ", host, ":", service, " failed: ",
-              std::strerror(errno));
-          return LoopControl::CONTINUE;
-        }
-        int rc = ::connect(socketFd, info->ai_addr, info->ai_addrlen);
-        if (rc != 0) {
-          // TODO: use inet_ntop and print the actual address
-          LOGW(
-              "Connection attempt to ", host, ":", service, " failed: ",
-              std::strerror(errno));
-          close(socketFd);
-          return LoopControl::CONTINUE;
-        }
-        fd = StreamFileDescriptor::createOwnerOf(socketFd);
-        return LoopControl::BREAK;
-      });
-  if (!anyTried) {
+  std::vector<Resolver::Address> addresses = interleaveFamilies(
+      Resolver::getInstance().resolve(createQuery(
+          host,
+          service,
+          Network::Family::ANY,
+          Network::Protocol::TCP,
+          Network::Mode::ACTIVE)),
+      getPreferredFamily(host));
+  if (addresses.empty()) {
     LOGE("Unknown host ", host, ":", service);
   }
-  if (fd == nullptr) {
+  size_t addressIndex = 0;
+  bool timedOut = false;
+  int socketFd = connectToAny(
+      addresses,
+      options,
+      deadline,
+      addressIndex,
+      timedOut);
+  if (timedOut) {
+    LOGW("Connection attempt to ", host, ":", service, " timed out");
+    return nullptr;
+  }
+  if (socketFd < 0) {
     throw std::runtime_error("Could not connect to " + host + ":" + service);
   }
-  LOGI("Connection attempt to ", host, ":", service, " was successful");
-  return std::move(fd);
+  const Resolver::Address& address = addresses[addressIndex];
+  setPreferredFamily(host, address.family);
+
+  // The socket stays non-blocking, the descriptor waits with poll when needed.
+  unique_ptr<StreamFileDescriptor> fd =
+      StreamFileDescriptor::createOwnerOf(socketFd);
+  if (options.quickAck) {
+    fd->setQuickAck(true);
+  }
+  LOGI(
+      "Connection attempt to ", host, ":", service, " (",
+      formatAddress(address), ") was successful");
+  return fd;
 }
 
 unique_ptr<MessageFileDescriptor> Network::createUdpListener(
-    const std::string& service) {
+    const std::string& service,
+    const SocketOptions& options) {
   LOGI("Trying to listen for UDP datagrams on service port ", service, "...");
   unique_ptr<MessageFileDescriptor> fd;
   bool anyTried = false;
@@ -116,23 +188,26 @@ unique_ptr<MessageFileDescriptor> Network::createUdpListener(
       Network::Family::ANY,
       Network::Protocol::UDP,
       Network::Mode::PASSIVE,
-      [service, &fd, &anyTried](const addrinfo* info) -> LoopControl {
+      [&options, &fd, &anyTried](
+          const Resolver::Address& address) -> LoopControl {
         int socketFd = socket(
-            info->ai_family,
-            info->ai_socktype,
-            info->ai_protocol);
+            address.family,
+            address.socketType,
+            address.protocol);
         if (socketFd < 0) {
-          // TODO: use inet_ntop and print the actual address
           LOGW(
-              "Listening on service port ", service, " failed: ",
+              "Listening on ", formatAddress(address), " failed: ",
               std::strerror(errno));
           return LoopControl::CONTINUE;
         }
-        int rc = ::bind(socketFd, info->ai_addr, info->ai_addrlen);
+        applySocketOptions(socketFd, address, options);
+        int rc = ::bind(
+            socketFd,
+            address.getSockaddr(),
+            address.addressLength);
         if (rc != 0) {
-          // TODO: use inet_ntop and print the actual address
           LOGW(
-              "Listening on service port ", service, " failed: ",
+              "Listening on ", formatAddress(address), " failed: ",
               std::strerror(errno));
           close(socketFd);
           return LoopControl::CONTINUE;
@@ -150,40 +225,376 @@ unique_ptr<MessageFileDescriptor> Network::createUdpListener(
   return std::move(fd);
 }
 
+unique_ptr<ListeningFileDescriptor> Network::createTcpListener(
+    const std::string& service,
+    int backlog,
+    const SocketOptions& options) {
+  LOGI("Trying to listen for TCP connections on service port ", service, "...");
+  // An IPv6 socket accepts IPv4 connections too, so try it first.
+  std::vector<Resolver::Address> addresses = interleaveFamilies(
+      Resolver::getInstance().resolve(createQuery(
+          /* host = */ "",
+          service,
+          Network::Family::ANY,
+          Network::Protocol::TCP,
+          Network::Mode::PASSIVE)),
+      AF_INET6);
+  for (const Resolver::Address& address : addresses) {
+    int socketFd = socket(
+        address.family,
+        address.socketType | SOCK_NONBLOCK | SOCK_CLOEXEC,
+        address.protocol);
+    if (socketFd < 0) {
+      LOGW(
+          "Listening on ", formatAddress(address), " failed: ",
+          std::strerror(errno));
+      continue;
+    }
+    setSocketOption(socketFd, SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+    if (address.family == AF_INET6) {
+      setSocketOption(socketFd, IPPROTO_IPV6, IPV6_V6ONLY, 0, "IPV6_V6ONLY");
+    }
+    applySocketOptions(socketFd, address, options);
+    int rc = ::bind(socketFd, address.getSockaddr(), address.addressLength);
+    if (rc == 0) {
+      rc = ::listen(socketFd, backlog);
+    }
+    if (rc != 0) {
+      LOGW(
+          "Listening on ", formatAddress(address), " failed: ",
+          std::strerror(errno));
+      close(socketFd);
+      continue;
+    }
+    unique_ptr<ListeningFileDescriptor> fd =
+        ListeningFileDescriptor::createOwnerOf(socketFd);
+    LOGI("Successfully listening on service port ", fd->getLocalService());
+    return fd;
+  }
+  throw std::runtime_error("Could not listen on service port " + service);
+}
+
+unique_ptr<StreamFileDescriptor> Network::createUnixConnection(
+    const std::string& path) {
+  LOGI("Trying to connect to ", path, " using a Unix stream socket...");
+  int socketFd = createUnixSocket(SOCK_STREAM, path);
+  try {
+    connectUnixSocket(socketFd, path);
+  } catch (...) {
+    close(socketFd);
+    throw;
+  }
+  LOGI("Connection attempt to ", path, " was successful");
+  return StreamFileDescriptor::createOwnerOf(socketFd);
+}
+
+unique_ptr<ListeningFileDescriptor> Network::createUnixListener(
+    const std::string& path,
+    int backlog) {
+  LOGI("Trying to listen for connections on Unix socket ", path, "...");
+  // Non-blocking like the TCP listener, accept waits with poll.
+  int socketFd = createUnixSocket(SOCK_STREAM | SOCK_NONBLOCK, path);
+  try {
+    bindUnixSocket(socketFd, path);
+    if (::listen(socketFd, backlog) != 0) {
+      throw std::runtime_error(std::strerror(errno));
+    }
+  } catch (...) {
+    close(socketFd);
+    throw;
+  }
+  LOGI("Successfully listening on Unix socket ", path);
+  return ListeningFileDescriptor::createOwnerOf(socketFd);
+}
+
+unique_ptr<MessageFileDescriptor> Network::createUnixDatagramConnection(
+    const std::string& path) {
+  LOGI("Trying to connect to ", path, " using a Unix datagram socket...");
+  int socketFd = createUnixSocket(SOCK_DGRAM, path);
+  try {
+    // Bind to an autogenerated abstract address, so that the other side can
+    // send datagrams back.
+    sa_family_t family = AF_UNIX;
+    if (::bind(
+        socketFd,
+        reinterpret_cast<const sockaddr*>(&family),
+        sizeof family) != 0) {
+      throw std::runtime_error(std::strerror(errno));
+    }
+    connectUnixSocket(socketFd, path);
+  } catch (...) {
+    close(socketFd);
+    throw;
+  }
+  LOGI("Connection attempt to ", path, " was successful");
+  return MessageFileDescriptor::createOwnerOf(socketFd);
+}
+
+unique_ptr<MessageFileDescriptor> Network::createUnixDatagramListener(
+    const std::string& path) {
+  LOGI("Trying to listen for datagrams on Unix socket ", path, "...");
+  int socketFd = createUnixSocket(SOCK_DGRAM, path);
+  try {
+    bindUnixSocket(socketFd, path);
+  } catch (...) {
+    close(socketFd);
+    throw;
+  }
+  LOGI("Successfully listening on Unix socket ", path);
+  return MessageFileDescriptor::createOwnerOf(socketFd);
+}
+
+void Network::prefetch(
+    const std::string& host,
+    const std::string& service) {
+  Resolver::getInstance().prefetch(createQuery(
+      host,
+      service,
+      Network::Family::ANY,
+      Network::Protocol::TCP,
+      Network::Mode::ACTIVE));
+}
+
+static int getPreferredFamily(const std::string& host) {
+  std::lock_guard<std::mutex> lock(preferredFamiliesMutex);
+  auto it = preferredFamilies.find(host);
+  if (it == preferredFamilies.end()) {
+    return AF_UNSPEC;
+  }
+  return it->second;
+}
+
+static void setPreferredFamily(const std::string& host, int family) {
+  std::lock_guard<std::mutex> lock(preferredFamiliesMutex);
+  preferredFamilies[host] = family;
+}
+
+static std::vector<Resolver::Address> interleaveFamilies(
+    const std::vector<Resolver::Address>& addresses,
+    int firstFamily) {
+  if (addresses.empty()) {
+    return addresses;
+  }
+  if (firstFamily == AF_UNSPEC) {
+    firstFamily = addresses.front().family;
+  }
+  std::deque<Resolver::Address> first;
+  std::deque<Resolver::Address> other;
+  for (const Resolver::Address& address : addresses) {
+    if (address.family == firstFamily) {
+      first.push_back(address);
+    } else {
+      other.push_back(address);
+    }
+  }
+  std::vector<Resolver::Address> result;
+  while (!first.empty() || !other.empty()) {
+    if (!first.empty()) {
+      result.push_back(first.front());
+      first.pop_front();
+    }
+    if (!other.empty()) {
+      result.push_back(other.front());
+      other.pop_front();
+    }
+  }
+  return result;
+}
+
+static int connectToAny(
+    const std::vector<Resolver::Address>& addresses,
+    const SocketOptions& options,
+    FileDescriptor::Deadline deadline,
+    size_t& addressIndex,
+    bool& timedOut) {
+  typedef std::chrono::steady_clock Clock;
+
+  struct Attempt {
+    int socketFd;
+    size_t addressIndex;
+  };
+
+  std::vector<Attempt> attempts;
+  size_t nextAddressIndex = 0;
+  Clock::time_point nextStart = Clock::now();
+  int winnerFd = -1;
+
+  while (winnerFd < 0 &&
+      (nextAddressIndex < addresses.size() || !attempts.empty())) {
+    Clock::time_point now = Clock::now();
+    if (now >= deadline) {
+      timedOut = true;
+      break;
+    }
+
+    if (nextAddressIndex < addresses.size() &&
+        (now >= nextStart || attempts.empty())) {
+      size_t index = nextAddressIndex++;
+      bool connected = false;
+      int socketFd = startConnecting(addresses[index], options, connected);
+      if (connected) {
+        winnerFd = socketFd;
+        addressIndex = index;
+      } else if (socketFd >= 0) {
+        attempts.push_back(Attempt{socketFd, index});
+        nextStart = now + CONNECTION_ATTEMPT_DELAY;
+      }
+      continue;
+    }
+
+    std::vector<pollfd> pollFds;
+    for (const Attempt& attempt : attempts) {
+      pollFds.push_back(pollfd{attempt.socketFd, POLLOUT, 0});
+    }
+    Clock::time_point wakeUp = deadline;
+    if (nextAddressIndex < addresses.size()) {
+      wakeUp = std::min(wakeUp, nextStart);
+    }
+    int timeout = -1;
+    if (wakeUp != Clock::time_point::max()) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          wakeUp - now);
+      timeout = static_cast<int>(std::min<decltype(remaining.count())>(
+          remaining.count() + 1,
+          INT_MAX));
+    }
+    int rc = poll(pollFds.data(), pollFds.size(), timeout);
+    if (rc < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      int error = errno;
+      for (const Attempt& attempt : attempts) {
+        close(attempt.socketFd);
+      }
+      throw std::runtime_error(std::strerror(error));
+    }
+
+    std::vector<Attempt> pending;
+    for (size_t i = 0; i < attempts.size(); ++i) {
+      const Attempt& attempt = attempts[i];
+      if (pollFds[i].revents == 0) {
+        pending.push_back(attempt);
+        continue;
+      }
+      int error = 0;
+      socklen_t errorLength = sizeof error;
+      if (getsockopt(
+          attempt.socketFd,
+          SOL_SOCKET,
+          SO_ERROR,
+          &error,
+          &errorLength) != 0) {
+        error = errno;
+      }
+      if (error == 0 && winnerFd < 0) {
+        winnerFd = attempt.socketFd;
+        addressIndex = attempt.addressIndex;
+      } else if (error == 0) {
+        pending.push_back(attempt);
+      } else {
+        LOGW(
+            "Connection attempt to ",
+            formatAddress(addresses[attempt.addressIndex]), " failed: ",
+            std::strerror(error));
+        close(attempt.socketFd);
+        // A failed attempt does not need to wait for the delay.
+        nextStart = now;
+      }
+    }
+    attempts.swap(pending);
+  }
+
+  for (const Attempt& attempt : attempts) {
+    close(attempt.socketFd);
+  }
+  return winnerFd;
+}
+
+static int startConnecting(
+    const Resolver::Address& address,
+    const SocketOptions& options,
+    bool& connected) {
+  int socketFd = socket(
+      address.family,
+      address.socketType | SOCK_NONBLOCK,
+      address.protocol);
+  if (socketFd < 0) {
+    LOGW(
+        "Connection attempt to ", formatAddress(address), " failed: ",
+        std::strerror(errno));
+    return -1;
+  }
+  applySocketOptions(socketFd, address, options);
+  int rc = ::connect(
+      socketFd,
+      address.getSockaddr(),
+      address.addressLength);
+  if (rc == 0) {
+    connected = true;
+    return socketFd;
+  }
+  if (errno != EINPROGRESS) {
+    LOGW(
+        "Connection attempt to ", formatAddress(address), " failed: ",
+        std::strerror(errno));
+    close(socketFd);
+    return -1;
+  }
+  return socketFd;
+}
+
+static std::string formatAddress(const Resolver::Address& address) {
+  char host[INET6_ADDRSTRLEN] = "?";
+  uint16_t port = 0;
+  if (address.family == AF_INET) {
+    const sockaddr_in* ipv4 =
+        reinterpret_cast<const sockaddr_in*>(&address.address);
+    inet_ntop(AF_INET, &ipv4->sin_addr, host, sizeof host);
+    port = ntohs(ipv4->sin_port);
+    return std::string(host) + ":" + std::to_string(port);
+  }
+  if (address.family == AF_INET6) {
+    const sockaddr_in6* ipv6 =
+        reinterpret_cast<const sockaddr_in6*>(&address.address);
+    inet_ntop(AF_INET6, &ipv6->sin6_addr, host, sizeof host);
+    port = ntohs(ipv6->sin6_port);
+    return "[" + std::string(host) + "]:" + std::to_string(port);
+  }
+  return host;
+}
+
+static Resolver::Query createQuery(
+    const std::string& host,
+    const std::string& service,
+    Network::Family family,
+    Network::Protocol protocol,
+    Network::Mode mode) {
+  Resolver::Query query;
+  query.host = host;
+  query.service = service;
+  query.family = getAiFamily(family);
+  query.socketType = getAiSocketType(protocol);
+  query.protocol = getAiProtocol(protocol);
+  query.flags = getAiFlags(mode);
+  return query;
+}
+
 static void forEachAddressInfo(
     const std::string& host,
     const std::string& service,
     Network::Family family,
     Network::Protocol protocol,
     Network::Mode mode,
-    std::function<LoopControl(const addrinfo*)> callback) {
-  addrinfo hints;
-  memset(&hints, 0, sizeof hints);
-  hints.ai_family = getAiFamily(family);
-  hints.ai_socktype = getAiSocketType(protocol);
-  hints.ai_protocol = getAiProtocol(protocol);
-  hints.ai_flags = getAiFlags(mode);
-  addrinfo* infos;
-  int rc = getaddrinfo(
-      host.empty() ? nullptr : host.c_str(),
-      service.c_str(),
-      &hints,
-      &infos);
-  if (rc != 0) {
-    throw std::runtime_error(gai_strerror(rc));
-  }
-  try {
-    for (addrinfo* info = infos; info != nullptr; info = info->ai_next) {
-      LoopControl loopControl = callback(info);
-      if (loopControl == LoopControl::BREAK) {
-        break;
-      }
+    std::function<LoopControl(const Resolver::Address&)> callback) {
+  std::vector<Resolver::Address> addresses = Resolver::getInstance().resolve(
+      createQuery(host, service, family, protocol, mode));
+  for (const Resolver::Address& address : addresses) {
+    LoopControl loopControl = callback(address);
+    if (loopControl == LoopControl::BREAK) {
+      break;
     }
-  } catch (...) {
-    freeaddrinfo(infos);
-    throw;
   }
-  freeaddrinfo(infos);
 }
 
 static int getAiFamily(Network::Family family) {
@@ -228,4 +639,192 @@ static int getAiFlags(Network::Mode mode) {
   throw std::runtime_error("Invalid mode");
 }
 
+static void applySocketOptions(
+    int socketFd,
+    const Resolver::Address& address,
+    const SocketOptions& options) {
+  if (options.receiveBufferSize > 0) {
+    setSocketOption(
+        socketFd,
+        SOL_SOCKET,
+        SO_RCVBUF,
+        options.receiveBufferSize,
+        "SO_RCVBUF");
+  }
+  if (options.sendBufferSize > 0) {
+    setSocketOption(
+        socketFd,
+        SOL_SOCKET,
+        SO_SNDBUF,
+        options.sendBufferSize,
+        "SO_SNDBUF");
+  }
+  if (options.busyPollMicroseconds > 0) {
+    setSocketOption(
+        socketFd,
+        SOL_SOCKET,
+        SO_BUSY_POLL,
+        options.busyPollMicroseconds,
+        "SO_BUSY_POLL");
+  }
+  if (options.typeOfService > 0) {
+    if (address.family == AF_INET6) {
+      setSocketOption(
+          socketFd,
+          IPPROTO_IPV6,
+          IPV6_TCLASS,
+          options.typeOfService,
+          "IPV6_TCLASS");
+    } else {
+      setSocketOption(
+          socketFd,
+          IPPROTO_IP,
+          IP_TOS,
+          options.typeOfService,
+          "IP_TOS");
+    }
+  }
+
+  if (options.reusePort) {
+    setSocketOption(socketFd, SOL_SOCKET, SO_REUSEPORT, 1, "SO_REUSEPORT");
+  }
+
+  if (address.protocol != IPPROTO_TCP) {
+    return;
+  }
+
+  if (options.noDelay) {
+    setSocketOption(socketFd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+  }
+  if (options.quickAck) {
+    setSocketOption(socketFd, IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK");
+  }
+  if (options.keepAlive) {
+    setSocketOption(socketFd, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+    if (options.keepAliveIdleSeconds > 0) {
+      setSocketOption(
+          socketFd,
+          IPPROTO_TCP,
+          TCP_KEEPIDLE,
+          options.keepAliveIdleSeconds,
+          "TCP_KEEPIDLE");
+    }
+    if (options.keepAliveIntervalSeconds > 0) {
+      setSocketOption(
+          socketFd,
+          IPPROTO_TCP,
+          TCP_KEEPINTVL,
+          options.keepAliveIntervalSeconds,
+          "TCP_KEEPINTVL");
+    }
+    if (options.keepAliveCount > 0) {
+      setSocketOption(
+          socketFd,
+          IPPROTO_TCP,
+          TCP_KEEPCNT,
+          options.keepAliveCount,
+          "TCP_KEEPCNT");
+    }
+  }
+}
+
+static void setSocketOption(
+    int socketFd,
+    int level,
+    int name,
+    int value,
+    const char* optionName) {
+  int rc = setsockopt(socketFd, level, name, &value, sizeof value);
+  if (rc != 0) {
+    // Tuning is best effort, the socket is still usable without it.
+    LOGW("Could not set ", optionName, ": ", std::strerror(errno));
+  }
+}
+
+static int createUnixSocket(int type, const std::string& path) {
+  int socketFd = socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+  if (socketFd < 0) {
+    throw std::runtime_error(
+        "Could not create a Unix socket for " + path + ": " +
+        std::strerror(errno));
+  }
+  return socketFd;
+}
+
+static socklen_t createUnixAddress(
+    const std::string& path,
+    sockaddr_un& address) {
+  memset(&address, 0, sizeof address);
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof address.sun_path) {
+    throw std::runtime_error("Invalid Unix socket path " + path);
+  }
+  memcpy(address.sun_path, path.data(), path.size());
+  if (path[0] == '@') {
+    address.sun_path[0] = '\0';
+    return static_cast<socklen_t>(
+        offsetof(sockaddr_un, sun_path) + path.size());
+  }
+  return sizeof address;
+}
+
+static void bindUnixSocket(int socketFd, const std::string& path) {
+  sockaddr_un address;
+  socklen_t addressLength = createUnixAddress(path, address);
+  if (path[0] != '@') {
+    struct stat status;
+    if (lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+      if (isUnixSocketAlive(address, addressLength)) {
+        throw std::runtime_error(
+            "Could not listen on " + path + ": " + std::strerror(EADDRINUSE));
+      }
+      // Left behind by a server that has exited.
+      unlink(path.c_str());
+    }
+  }
+  int rc = ::bind(
+      socketFd,
+      reinterpret_cast<const sockaddr*>(&address),
+      addressLength);
+  if (rc != 0) {
+    throw std::runtime_error(
+        "Could not listen on " + path + ": " + std::strerror(errno));
+  }
+}
+
+// A socket file that nobody listens on refuses connections.
+static bool isUnixSocketAlive(
+    const sockaddr_un& address,
+    socklen_t addressLength) {
+  int socketFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (socketFd < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  int rc = ::connect(
+      socketFd,
+      reinterpret_cast<const sockaddr*>(&address),
+      addressLength);
+  int error = errno;
+  close(socketFd);
+  return rc == 0 || error != ECONNREFUSED;
+}
+
+static void connectUnixSocket(int socketFd, const std::string& path) {
+  sockaddr_un address;
+  socklen_t addressLength = createUnixAddress(path, address);
+  int rc = ::connect(
+      socketFd,
+      reinterpret_cast<const sockaddr*>(&address),
+      addressLength);
+  if (rc != 0) {
+    throw std::runtime_error(
+        "Could not connect to " + path + ": " + std::strerror(errno));
+  }
+  // Same as TCP connections, the descriptor waits with poll when needed.
+  int flags = fcntl(socketFd, F_GETFL);
+  if (flags < 0 || fcntl(socketFd, F_SETFL, flags | O_NONBLOCK) != 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+}
+
 }}
@@ -0,0 +1,212 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <locale.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#if defined(__has_include)
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv>
+#endif
+#endif
+
+#include "Core/OutputBuffer.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+
+static char* formatUnsigned(unsigned long long value, char* end);
+template <typename Type>
+static void formatFloatingPoint(Type value, string& output);
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+OutputBuffer::OutputBuffer():
+  mData() {}
+
+void OutputBuffer::clear() {
+  mData.clear();
+}
+
+void OutputBuffer::append(char ch) {
+  mData.push_back(ch);
+}
+
+void OutputBuffer::append(const char* str) {
+  mData.append(str);
+}
+
+void OutputBuffer::append(const char* data, size_t size) {
+  mData.append(data, size);
+}
+
+void OutputBuffer::append(const string& str) {
+  mData.append(str);
+}
+
+void OutputBuffer::append(int value) {
+  appendSigned(value);
+}
+
+void OutputBuffer::append(long value) {
+  appendSigned(value);
+}
+
+void OutputBuffer::append(long long value) {
+  appendSigned(value);
+}
+
+void OutputBuffer::append(unsigned value) {
+  appendUnsigned(value);
+}
+
+void OutputBuffer::append(unsigned long value) {
+  appendUnsigned(value);
+}
+
+void OutputBuffer::append(unsigned long long value) {
+  appendUnsigned(value);
+}
+
+void OutputBuffer::append(float value) {
+  formatFloatingPoint(value, mData);
+}
+
+void OutputBuffer::append(double value) {
+  formatFloatingPoint(value, mData);
+}
+
+bool OutputBuffer::isEmpty() const {
+  return mData.empty();
+}
+
+size_t OutputBuffer::getSize() const {
+  return mData.size();
+}
+
+const string& OutputBuffer::getData() const {
+  return mData;
+}
+
+void OutputBuffer::appendSigned(long long value) {
+  if (value < 0) {
+    mData.push_back('-');
+    // Also correct for the minimal value, which has no positive counterpart.
+    appendUnsigned(0ULL - static_cast<unsigned long long>(value));
+  } else {
+    appendUnsigned(static_cast<unsigned long long>(value));
+  }
+}
+
+void OutputBuffer::appendUnsigned(unsigned long long value) {
+  char digits[24];
+  char* end = digits + sizeof digits;
+  char* begin = formatUnsigned(value, end);
+  mData.append(begin, end);
+}
+
+// Writes the digits backwards, two at a time, and returns the first one.
+static char* formatUnsigned(unsigned long long value, char* end) {
+  while (value >= 100) {
+    size_t index = static_cast<size_t>(value % 100) * 2;
+    value /= 100;
+    *--end = DIGIT_PAIRS[index + 1];
+    *--end = DIGIT_PAIRS[index];
+  }
+  if (value >= 10) {
+    size_t index = static_cast<size_t>(value) * 2;
+    *--end = DIGIT_PAIRS[index + 1];
+    *--end = DIGIT_PAIRS[index];
+  } else {
+    *--end = static_cast<char>('0' + value);
+  }
+  return end;
+}
+
+template <typename Type>
+static void formatFloatingPoint(Type value, string& output) {
+  char buffer[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  auto result = std::to_chars(buffer, buffer + sizeof buffer, value);
+  output.append(buffer, result.ptr);
+#else
+  // Without to_chars, look for the lowest precision at which the number
+  // reads back exactly, which it always does at the highest one. The lowest
+  // one is tried first, because it fits most numbers, then the rest of the
+  // range is bisected.
+  static const locale_t cLocale = newlocale(LC_ALL_MASK, "C", locale_t());
+  locale_t previousLocale = uselocale(cLocale);
+  int length = 0;
+  int formattedPrecision = 0;
+  auto format = [&](int precision) {
+    length = std::snprintf(
+        buffer,
+        sizeof buffer,
+        "%.*g",
+        precision,
+        static_cast<double>(value));
+    formattedPrecision = precision;
+  };
+  auto isExact = [&](int precision) {
+    format(precision);
+    return static_cast<Type>(std::strtod(buffer, nullptr)) == value;
+  };
+  int low = sizeof(Type) == sizeof(float) ? 6 : 15;
+  int high = sizeof(Type) == sizeof(float) ? 9 : 17;
+  if (isExact(low)) {
+    high = low;
+  } else {
+    ++low;
+    while (low < high) {
+      int middle = (low + high) / 2;
+      if (isExact(middle)) {
+        high = middle;
+      } else {
+        low = middle + 1;
+      }
+    }
+  }
+  if (formattedPrecision != high) {
+    format(high);
+  }
+  uselocale(previousLocale);
+  output.append(buffer, static_cast<size_t>(length));
+#endif
+}
+
+}}
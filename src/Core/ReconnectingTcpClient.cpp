@@ -0,0 +1,223 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "LogMacro.h"
+
+#include "Core/ReconnectingTcpClient.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+
+ReconnectingTcpClient::ReconnectingTcpClient(
+    const string& host,
+    const string& service,
+    const SocketOptions& options):
+  mHost(host),
+  mService(service),
+  mOptions(options),
+  mHandshake(),
+  mInitialDelay(10),
+  mMaxDelay(1000),
+  mConnectTimeout(500),
+  mMaxAttempts(0),
+  mReplayLimit(1024),
+  mClient(),
+  mUnanswered(),
+  mConnectionCount(0),
+  mFailedAttempts(0),
+  mDelay(mInitialDelay),
+  mNextAttempt(FileDescriptor::Deadline::min()) {}
+
+void ReconnectingTcpClient::setHandshake(const Handshake& handshake) {
+  mHandshake = handshake;
+}
+
+void ReconnectingTcpClient::setBackoff(
+    std::chrono::milliseconds initialDelay,
+    std::chrono::milliseconds maxDelay) {
+  mInitialDelay = initialDelay;
+  mMaxDelay = maxDelay;
+  mDelay = initialDelay;
+}
+
+void ReconnectingTcpClient::setConnectTimeout(
+    std::chrono::milliseconds timeout) {
+  mConnectTimeout = timeout;
+}
+
+void ReconnectingTcpClient::setMaxAttempts(size_t maxAttempts) {
+  mMaxAttempts = maxAttempts;
+}
+
+void ReconnectingTcpClient::setReplayLimit(size_t replayLimit) {
+  mReplayLimit = replayLimit;
+}
+
+void ReconnectingTcpClient::connect() {
+  while (!reconnectIfDue()) {
+    std::this_thread::sleep_until(mNextAttempt);
+  }
+}
+
+bool ReconnectingTcpClient::isConnected() const {
+  return mClient.isConnected();
+}
+
+int ReconnectingTcpClient::getNativeHandle() const {
+  return mClient.getNativeHandle();
+}
+
+FileDescriptor::Deadline ReconnectingTcpClient::getNextAttempt() const {
+  if (mClient.isConnected()) {
+    return FileDescriptor::Deadline::max();
+  }
+  return mNextAttempt;
+}
+
+void ReconnectingTcpClient::sendLine(const string& command) {
+  if (mUnanswered.size() >= mReplayLimit) {
+    throw std::runtime_error("Too many unanswered commands");
+  }
+  if (!reconnectIfDue()) {
+    // The command is sent with the other unanswered ones after reconnecting.
+    mUnanswered.push_back(command);
+    return;
+  }
+  mUnanswered.push_back(command);
+  try {
+    mClient.sendLine(command);
+  } catch (const std::runtime_error& e) {
+    LOGW("Sending to ", mHost, ":", mService, " failed: ", e.what());
+    disconnect();
+    reconnectIfDue();
+  }
+}
+
+string ReconnectingTcpClient::getLine() {
+  connect();
+  while (true) {
+    try {
+      string line = mClient.getLine();
+      if (!mUnanswered.empty()) {
+        mUnanswered.pop_front();
+      }
+      return line;
+    } catch (const std::runtime_error& e) {
+      LOGW("Receiving from ", mHost, ":", mService, " failed: ", e.what());
+      disconnect();
+      connect();
+    }
+  }
+}
+
+size_t ReconnectingTcpClient::linesReady() {
+  if (!reconnectIfDue()) {
+    return 0;
+  }
+  try {
+    return mClient.linesReady();
+  } catch (const std::runtime_error& e) {
+    LOGW("Receiving from ", mHost, ":", mService, " failed: ", e.what());
+    disconnect();
+    reconnectIfDue();
+    return 0;
+  }
+}
+
+size_t ReconnectingTcpClient::getUnansweredCount() const {
+  return mUnanswered.size();
+}
+
+size_t ReconnectingTcpClient::getConnectionCount() const {
+  return mConnectionCount;
+}
+
+void ReconnectingTcpClient::disconnect() {
+  mClient = TcpClient();
+  // The first attempt after a failure is made immediately.
+  mFailedAttempts = 0;
+  mDelay = mInitialDelay;
+  mNextAttempt = FileDescriptor::Deadline::min();
+}
+
+bool ReconnectingTcpClient::reconnectIfDue() {
+  if (mClient.isConnected()) {
+    return true;
+  }
+  if (std::chrono::steady_clock::now() < mNextAttempt) {
+    return false;
+  }
+  if (tryConnect()) {
+    ++mConnectionCount;
+    mFailedAttempts = 0;
+    mDelay = mInitialDelay;
+    return true;
+  }
+  ++mFailedAttempts;
+  if (mMaxAttempts != 0 && mFailedAttempts >= mMaxAttempts) {
+    // The next call starts over with an immediate attempt.
+    disconnect();
+    throw std::runtime_error(
+        "Could not reconnect to " + mHost + ":" + mService);
+  }
+  mNextAttempt = std::chrono::steady_clock::now() + mDelay;
+  mDelay = std::min(mDelay * 2, mMaxDelay);
+  return false;
+}
+
+bool ReconnectingTcpClient::tryConnect() {
+  TcpClient client;
+  try {
+    client = TcpClient(mHost, mService, mConnectTimeout, mOptions);
+    if (!client.isConnected()) {
+      return false;
+    }
+    if (mHandshake) {
+      mHandshake(client);
+    }
+    // All unanswered commands go out in a single write.
+    string replay;
+    for (const string& command : mUnanswered) {
+      replay += command;
+      replay += '\n';
+    }
+    if (!replay.empty()) {
+      client.sendRaw(replay);
+    }
+  } catch (const std::runtime_error& e) {
+    LOGW("Connecting to ", mHost, ":", mService, " failed: ", e.what());
+    return false;
+  }
+  mClient = std::move(client);
+  return true;
+}
+
+}}
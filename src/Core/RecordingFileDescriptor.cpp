@@ -0,0 +1,156 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include "LogMacro.h"
+
+#include "Core/RecordingFileDescriptor.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::shared_ptr;
+using std::string;
+
+static int openLog(const string& path);
+
+const char RecordingFileDescriptor::MAGIC[8] =
+    {'M', 'K', 'S', 'E', 'S', 'S', '0', '1'};
+
+RecordingFileDescriptor::RecordingFileDescriptor(
+    const shared_ptr<FileDescriptor>& fd,
+    const string& path):
+  mFd(fd),
+  mLogFd(openLog(path)),
+  mStart(std::chrono::steady_clock::now()),
+  mRecording(true) {
+  FileHeader header;
+  memcpy(header.magic, MAGIC, sizeof header.magic);
+  header.startTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  ssize_t rc = ::write(mLogFd, &header, sizeof header);
+  if (rc != static_cast<ssize_t>(sizeof header)) {
+    int error = errno;
+    close(mLogFd);
+    throw std::runtime_error(std::strerror(error));
+  }
+}
+
+RecordingFileDescriptor::~RecordingFileDescriptor() {
+  close(mLogFd);
+}
+
+bool RecordingFileDescriptor::isReadyForReading() const {
+  return mFd->isReadyForReading();
+}
+
+string RecordingFileDescriptor::read() const {
+  string data = mFd->read();
+  record(Direction::RECEIVED, data);
+  return data;
+}
+
+void RecordingFileDescriptor::write(const string& data) const {
+  mFd->write(data);
+  record(Direction::SENT, data);
+}
+
+string RecordingFileDescriptor::readWithTimestamp(
+    Timestamp& arrivalTime) const {
+  string data = mFd->readWithTimestamp(arrivalTime);
+  record(Direction::RECEIVED, data);
+  return data;
+}
+
+bool RecordingFileDescriptor::isEndOfStream(const string& data) const {
+  return mFd->isEndOfStream(data);
+}
+
+bool RecordingFileDescriptor::waitForReading(Deadline deadline) const {
+  return mFd->waitForReading(deadline);
+}
+
+bool RecordingFileDescriptor::writeWithDeadline(
+    const string& data,
+    Deadline deadline) const {
+  if (!mFd->writeWithDeadline(data, deadline)) {
+    return false;
+  }
+  record(Direction::SENT, data);
+  return true;
+}
+
+int RecordingFileDescriptor::getNativeHandle() const {
+  return mFd->getNativeHandle();
+}
+
+void RecordingFileDescriptor::record(
+    Direction direction,
+    const string& data) const {
+  if (data.empty() || !mRecording) {
+    return;
+  }
+  RecordHeader header;
+  header.nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - mStart).count();
+  header.size = static_cast<uint32_t>(data.size());
+  header.direction = direction;
+
+  // A single append per record keeps records from both directions whole.
+  struct iovec iov[2];
+  iov[0].iov_base = &header;
+  iov[0].iov_len = sizeof header;
+  iov[1].iov_base = const_cast<char*>(data.data());
+  iov[1].iov_len = data.size();
+  ssize_t rc = writev(mLogFd, iov, 2);
+  // The data was already read or written, so failing here would lose it.
+  // A partial record would corrupt the rest of the log, so stop recording.
+  if (rc < 0) {
+    LOGE("Recording the session failed: ", std::strerror(errno));
+    mRecording = false;
+  } else if (static_cast<size_t>(rc) != sizeof header + data.size()) {
+    LOGE("Recording the session failed: the record was cut short");
+    mRecording = false;
+  }
+}
+
+static int openLog(const string& path) {
+  int fd = open(
+      path.c_str(),
+      O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+      0644);
+  if (fd < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  return fd;
+}
+
+}}
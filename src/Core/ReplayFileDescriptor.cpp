@@ -0,0 +1,178 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "Core/RecordingFileDescriptor.h"
+
+#include "Core/ReplayFileDescriptor.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+using std::unique_ptr;
+
+typedef RecordingFileDescriptor::FileHeader FileHeader;
+typedef RecordingFileDescriptor::RecordHeader RecordHeader;
+
+ReplayFileDescriptor::ReplayFileDescriptor(
+    const char* data,
+    size_t size,
+    Pacing pacing):
+  mData(data),
+  mSize(size),
+  mPacing(pacing),
+  mStart(std::chrono::steady_clock::now()),
+  mRecordingStart(),
+  mOffset(sizeof(FileHeader)) {
+  FileHeader header;
+  memcpy(&header, mData, sizeof header);
+  mRecordingStart = Timestamp(
+      std::chrono::duration_cast<Timestamp::duration>(
+          std::chrono::nanoseconds(header.startTime)));
+}
+
+ReplayFileDescriptor::~ReplayFileDescriptor() {
+  munmap(const_cast<char*>(mData), mSize);
+}
+
+bool ReplayFileDescriptor::isReadyForReading() const {
+  if (!findNextReceived()) {
+    return true;
+  }
+  return getReadyTime() <= std::chrono::steady_clock::now();
+}
+
+string ReplayFileDescriptor::read() const {
+  Timestamp arrivalTime;
+  return readWithTimestamp(arrivalTime);
+}
+
+void ReplayFileDescriptor::write(const string&) const {}
+
+string ReplayFileDescriptor::readWithTimestamp(Timestamp& arrivalTime) const {
+  if (!findNextReceived()) {
+    arrivalTime = std::chrono::system_clock::now();
+    return string();
+  }
+  if (mPacing == Pacing::REAL_TIME) {
+    std::this_thread::sleep_until(getReadyTime());
+  }
+
+  RecordHeader header;
+  memcpy(&header, mData + mOffset, sizeof header);
+  arrivalTime = mRecordingStart + std::chrono::duration_cast<
+      Timestamp::duration>(std::chrono::nanoseconds(header.nanoseconds));
+  string data(mData + mOffset + sizeof header, header.size);
+  mOffset += sizeof header + header.size;
+  return data;
+}
+
+bool ReplayFileDescriptor::waitForReading(Deadline deadline) const {
+  if (!findNextReceived()) {
+    return true;
+  }
+  Deadline readyTime = getReadyTime();
+  if (readyTime > deadline) {
+    std::this_thread::sleep_until(deadline);
+    return false;
+  }
+  std::this_thread::sleep_until(readyTime);
+  return true;
+}
+
+unique_ptr<ReplayFileDescriptor> ReplayFileDescriptor::createFromFile(
+    const string& path,
+    Pacing pacing) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    int error = errno;
+    close(fd);
+    throw std::runtime_error(std::strerror(error));
+  }
+  size_t size = static_cast<size_t>(info.st_size);
+  if (size < sizeof(FileHeader)) {
+    close(fd);
+    throw std::runtime_error("Not a session log: " + path);
+  }
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int error = errno;
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error(std::strerror(error));
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+  if (memcmp(data, RecordingFileDescriptor::MAGIC,
+      sizeof RecordingFileDescriptor::MAGIC) != 0) {
+    munmap(data, size);
+    throw std::runtime_error("Not a session log: " + path);
+  }
+  return unique_ptr<ReplayFileDescriptor>(new ReplayFileDescriptor(
+      static_cast<const char*>(data),
+      size,
+      pacing));
+}
+
+bool ReplayFileDescriptor::findNextReceived() const {
+  while (mOffset + sizeof(RecordHeader) <= mSize) {
+    RecordHeader header;
+    memcpy(&header, mData + mOffset, sizeof header);
+    if (mOffset + sizeof header + header.size > mSize) {
+      // A record cut short, for example by a crash of the recording process.
+      mOffset = mSize;
+      return false;
+    }
+    if (header.direction == RecordingFileDescriptor::Direction::RECEIVED) {
+      return true;
+    }
+    mOffset += sizeof header + header.size;
+  }
+  return false;
+}
+
+FileDescriptor::Deadline ReplayFileDescriptor::getReadyTime() const {
+  if (mPacing == Pacing::AS_FAST_AS_POSSIBLE) {
+    return mStart;
+  }
+  RecordHeader header;
+  memcpy(&header, mData + mOffset, sizeof header);
+  return mStart + std::chrono::duration_cast<Deadline::duration>(
+      std::chrono::nanoseconds(header.nanoseconds));
+}
+
+}}
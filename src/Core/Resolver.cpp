@@ -0,0 +1,284 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <netdb.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "LogMacro.h"
+
+#include "Core/Resolver.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::chrono::milliseconds;
+using std::string;
+using std::vector;
+
+static bool isPermanentError(int error);
+
+Resolver::Query::Query():
+  host(),
+  service(),
+  family(0),
+  socketType(0),
+  protocol(0),
+  flags(0) {}
+
+bool Resolver::Query::operator < (const Query& other) const {
+  return std::tie(host, service, family, socketType, protocol, flags) <
+      std::tie(
+          other.host,
+          other.service,
+          other.family,
+          other.socketType,
+          other.protocol,
+          other.flags);
+}
+
+const sockaddr* Resolver::Address::getSockaddr() const {
+  return reinterpret_cast<const sockaddr*>(&address);
+}
+
+Resolver::Entry::Entry():
+  pending(false),
+  error(0),
+  addresses(),
+  expiration() {}
+
+Resolver::Resolver(const Lookup& lookup):
+  mLookup(lookup),
+  mMutex(),
+  mEntryUpdated(),
+  mQueueUpdated(),
+  mEntries(),
+  mQueue(),
+  mThread(),
+  mStopping(false),
+  mPositiveTimeToLive(std::chrono::seconds(60)),
+  mNegativeTimeToLive(std::chrono::seconds(5)) {}
+
+Resolver::~Resolver() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mQueueUpdated.notify_all();
+  if (mThread.joinable()) {
+    mThread.join();
+  }
+}
+
+Resolver& Resolver::getInstance() {
+  static Resolver instance;
+  return instance;
+}
+
+vector<Resolver::Address> Resolver::resolve(const Query& query) {
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+      Entry& entry = mEntries[query];
+      bool expired = Clock::now() >= entry.expiration;
+      if (!entry.addresses.empty()) {
+        if (expired && !entry.pending) {
+          entry.pending = true;
+          scheduleUpdate(query);
+        }
+        return entry.addresses;
+      }
+      if (!entry.pending) {
+        if (!expired) {
+          throw std::runtime_error(gai_strerror(entry.error));
+        }
+        entry.pending = true;
+        break;
+      }
+      // Somebody else is already resolving the same query.
+      mEntryUpdated.wait(lock);
+    }
+  }
+
+  vector<Address> addresses;
+  int error = update(query, addresses);
+  if (error != 0) {
+    throw std::runtime_error(gai_strerror(error));
+  }
+  return addresses;
+}
+
+void Resolver::prefetch(const Query& query) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  Entry& entry = mEntries[query];
+  if (!entry.pending && Clock::now() >= entry.expiration) {
+    entry.pending = true;
+    scheduleUpdate(query);
+  }
+}
+
+void Resolver::pin(const Query& query, const vector<Address>& addresses) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  Entry& entry = mEntries[query];
+  entry.error = 0;
+  entry.addresses = addresses;
+  entry.expiration = Clock::time_point::max();
+  mEntryUpdated.notify_all();
+}
+
+void Resolver::clear() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mEntries.clear();
+}
+
+void Resolver::setPositiveTimeToLive(milliseconds timeToLive) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mPositiveTimeToLive = timeToLive;
+}
+
+milliseconds Resolver::getPositiveTimeToLive() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mPositiveTimeToLive;
+}
+
+void Resolver::setNegativeTimeToLive(milliseconds timeToLive) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mNegativeTimeToLive = timeToLive;
+}
+
+milliseconds Resolver::getNegativeTimeToLive() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mNegativeTimeToLive;
+}
+
+int Resolver::lookupAddresses(
+    const Query& query,
+    vector<Address>& addresses) {
+  addrinfo hints;
+  memset(&hints, 0, sizeof hints);
+  hints.ai_family = query.family;
+  hints.ai_socktype = query.socketType;
+  hints.ai_protocol = query.protocol;
+  hints.ai_flags = query.flags;
+  addrinfo* infos;
+  int rc = getaddrinfo(
+      query.host.empty() ? nullptr : query.host.c_str(),
+      query.service.c_str(),
+      &hints,
+      &infos);
+  if (rc != 0) {
+    return rc;
+  }
+  for (addrinfo* info = infos; info != nullptr; info = info->ai_next) {
+    Address address;
+    memset(&address, 0, sizeof address);
+    address.family = info->ai_family;
+    address.socketType = info->ai_socktype;
+    address.protocol = info->ai_protocol;
+    memcpy(&address.address, info->ai_addr, info->ai_addrlen);
+    address.addressLength = info->ai_addrlen;
+    addresses.push_back(address);
+  }
+  freeaddrinfo(infos);
+  return 0;
+}
+
+int Resolver::update(const Query& query, vector<Address>& addresses) {
+  int error;
+  try {
+    error = mLookup(query, addresses);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries[query].pending = false;
+    mEntryUpdated.notify_all();
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  Entry& entry = mEntries[query];
+  entry.pending = false;
+  entry.error = error;
+  if (error == 0) {
+    entry.addresses = addresses;
+    entry.expiration = Clock::now() + mPositiveTimeToLive;
+  } else if (isPermanentError(error)) {
+    entry.addresses.clear();
+    entry.expiration = Clock::now() + mNegativeTimeToLive;
+  }
+  // Temporary failures are not cached, the next resolve tries again.
+  mEntryUpdated.notify_all();
+  return error;
+}
+
+void Resolver::scheduleUpdate(const Query& query) {
+  mQueue.push_back(query);
+  if (!mThread.joinable()) {
+    mThread = std::thread(&Resolver::runBackgroundThread, this);
+  }
+  mQueueUpdated.notify_one();
+}
+
+void Resolver::runBackgroundThread() {
+  while (true) {
+    Query query;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      while (mQueue.empty() && !mStopping) {
+        mQueueUpdated.wait(lock);
+      }
+      if (mStopping) {
+        return;
+      }
+      query = std::move(mQueue.front());
+      mQueue.pop_front();
+    }
+    try {
+      vector<Address> addresses;
+      int error = update(query, addresses);
+      if (error != 0) {
+        LOGW(
+            "Could not resolve ", query.host, ":", query.service, ": ",
+            gai_strerror(error));
+      }
+    } catch (const std::exception& e) {
+      LOGW(
+          "Could not resolve ", query.host, ":", query.service, ": ",
+          e.what());
+    }
+  }
+}
+
+static bool isPermanentError(int error) {
+  switch (error) {
+    case EAI_AGAIN:
+    case EAI_MEMORY:
+    case EAI_SYSTEM:
+      return false;
+    default:
+      return true;
+  }
+}
+
+}}
@@ -0,0 +1,173 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "Core/SendScheduler.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+
+typedef FileDescriptor::Deadline Deadline;
+
+static Deadline::duration getInterval(double commandsPerSecond);
+static Deadline::duration getTolerance(
+    Deadline::duration interval,
+    size_t burst);
+static int createTimer();
+
+SendScheduler::SendScheduler(
+    TcpClient& client,
+    double commandsPerSecond,
+    size_t burst):
+  mClient(client),
+  mInterval(getInterval(commandsPerSecond)),
+  mTolerance(getTolerance(mInterval, burst)),
+  mBucketFullAt(),
+  mQueue(),
+  mBuffer(),
+  mTimerFd(createTimer()) {}
+
+SendScheduler::~SendScheduler() {
+  close(mTimerFd);
+}
+
+void SendScheduler::sendLine(const string& command) {
+  Deadline now = std::chrono::steady_clock::now();
+  if (mQueue.empty() && getNextSendTime() <= now) {
+    takeToken(now);
+    mClient.sendLine(command);
+    return;
+  }
+  mQueue.push_back(command);
+  if (mQueue.size() == 1) {
+    armTimer();
+  }
+}
+
+size_t SendScheduler::releaseDue() {
+  uint64_t expirations;
+  if (::read(mTimerFd, &expirations, sizeof expirations) < 0 &&
+      errno != EAGAIN) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+
+  Deadline now = std::chrono::steady_clock::now();
+  mBuffer.clear();
+  size_t count = 0;
+  while (!mQueue.empty() && getNextSendTime() <= now) {
+    takeToken(now);
+    mBuffer.append(mQueue.front());
+    mBuffer.append('\n');
+    mQueue.pop_front();
+    ++count;
+  }
+  if (count > 0) {
+    mClient.sendRaw(mBuffer.getData());
+  }
+  if (!mQueue.empty()) {
+    armTimer();
+  }
+  return count;
+}
+
+bool SendScheduler::waitForAll(Deadline deadline) {
+  while (!mQueue.empty()) {
+    if (!FileDescriptor::waitUntilReady(mTimerFd, POLLIN, deadline)) {
+      return false;
+    }
+    releaseDue();
+  }
+  return true;
+}
+
+size_t SendScheduler::getQueuedCount() const {
+  return mQueue.size();
+}
+
+int SendScheduler::getNativeHandle() const {
+  return mTimerFd;
+}
+
+Deadline SendScheduler::getNextSendTime() const {
+  return mBucketFullAt - mTolerance;
+}
+
+void SendScheduler::takeToken(Deadline now) {
+  mBucketFullAt = std::max(mBucketFullAt, now) + mInterval;
+}
+
+void SendScheduler::armTimer() {
+  // steady_clock is CLOCK_MONOTONIC on Linux.
+  auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      getNextSendTime().time_since_epoch()).count();
+  // A zero time would disarm the timer.
+  sinceEpoch = std::max<decltype(sinceEpoch)>(sinceEpoch, 1);
+
+  itimerspec spec;
+  memset(&spec, 0, sizeof spec);
+  spec.it_value.tv_sec = static_cast<time_t>(sinceEpoch / 1000000000);
+  spec.it_value.tv_nsec = static_cast<long>(sinceEpoch % 1000000000);
+  if (timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+}
+
+static Deadline::duration getInterval(double commandsPerSecond) {
+  if (!(commandsPerSecond > 0.0)) {
+    throw std::runtime_error("SendScheduler rate must be positive");
+  }
+  return std::chrono::duration_cast<Deadline::duration>(
+      std::chrono::duration<double>(1.0 / commandsPerSecond));
+}
+
+static Deadline::duration getTolerance(
+    Deadline::duration interval,
+    size_t burst) {
+  if (burst == 0) {
+    throw std::runtime_error("SendScheduler burst must not be zero");
+  }
+  return interval * static_cast<Deadline::rep>(burst - 1);
+}
+
+static int createTimer() {
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  return fd;
+}
+
+}}
@@ -0,0 +1,179 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "LogMacro.h"
+
+#include "Core/SessionGroup.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+using std::vector;
+
+static int createEpoll();
+
+SessionGroup::SessionGroup():
+  mEpollFd(createEpoll()),
+  mClients(),
+  mClosed(),
+  mJustClosed(),
+  mReady(),
+  mBroadcastBuffer() {}
+
+SessionGroup::~SessionGroup() {
+  ::close(mEpollFd);
+}
+
+size_t SessionGroup::add(TcpClient&& client) {
+  if (client.hasBackgroundReceiver()) {
+    throw std::runtime_error(
+        "SessionGroup cannot use a client with a background receiver");
+  }
+  int fd = client.getNativeHandle();
+  if (fd < 0) {
+    throw std::runtime_error("SessionGroup needs a connected client");
+  }
+
+  size_t session = mClients.size();
+  epoll_event event;
+  memset(&event, 0, sizeof event);
+  event.events = EPOLLIN;
+  event.data.u64 = session;
+  if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+
+  mClients.push_back(std::move(client));
+  mClosed.push_back(false);
+  mJustClosed.push_back(false);
+  return session;
+}
+
+size_t SessionGroup::size() const {
+  return mClients.size();
+}
+
+TcpClient& SessionGroup::get(size_t session) {
+  return mClients.at(session);
+}
+
+bool SessionGroup::isClosed(size_t session) const {
+  return mClosed.at(session) && mClients[session].linesBuffered() == 0;
+}
+
+const vector<size_t>& SessionGroup::waitForLines(
+    FileDescriptor::Deadline deadline) {
+  mReady.clear();
+  while (true) {
+    // Lines that are already buffered do not need any system call, but
+    // the sessions that are readable right now are still collected.
+    bool anyBuffered = false;
+    for (const TcpClient& client : mClients) {
+      if (client.linesBuffered() > 0) {
+        anyBuffered = true;
+        break;
+      }
+    }
+    receive(anyBuffered ? 0 : FileDescriptor::getPollTimeout(deadline));
+
+    for (size_t session = 0; session < mClients.size(); ++session) {
+      if (mClients[session].linesBuffered() > 0 || mJustClosed[session]) {
+        mReady.push_back(session);
+        mJustClosed[session] = false;
+      }
+    }
+    if (!mReady.empty() || std::chrono::steady_clock::now() >= deadline) {
+      return mReady;
+    }
+  }
+}
+
+void SessionGroup::broadcastLine(const string& line) {
+  mBroadcastBuffer.clear();
+  mBroadcastBuffer.append(line);
+  mBroadcastBuffer.append('\n');
+  for (size_t session = 0; session < mClients.size(); ++session) {
+    if (mClosed[session]) {
+      continue;
+    }
+    try {
+      mClients[session].sendRaw(mBroadcastBuffer.getData());
+    } catch (const std::runtime_error& e) {
+      LOGW("Session ", session, " was closed: ", e.what());
+      close(session);
+    }
+  }
+}
+
+void SessionGroup::receive(int timeout) {
+  const int MAX_EVENTS = 64;
+  epoll_event events[MAX_EVENTS];
+  int count = epoll_wait(mEpollFd, events, MAX_EVENTS, timeout);
+  if (count < 0) {
+    if (errno == EINTR) {
+      return;
+    }
+    throw std::runtime_error(std::strerror(errno));
+  }
+  for (int i = 0; i < count; ++i) {
+    size_t session = static_cast<size_t>(events[i].data.u64);
+    try {
+      mClients[session].readOnce();
+    } catch (const std::runtime_error& e) {
+      LOGW("Session ", session, " was closed: ", e.what());
+      close(session);
+    }
+  }
+}
+
+void SessionGroup::close(size_t session) {
+  epoll_ctl(
+      mEpollFd,
+      EPOLL_CTL_DEL,
+      mClients[session].getNativeHandle(),
+      nullptr);
+  mClosed[session] = true;
+  mJustClosed[session] = true;
+}
+
+static int createEpoll() {
+  int fd = epoll_create1(EPOLL_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  return fd;
+}
+
+}}
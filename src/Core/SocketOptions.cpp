@@ -0,0 +1,68 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <netinet/ip.h>
+
+#include "Core/SocketOptions.h"
+
+namespace MarathonKit {
+namespace Core {
+
+SocketOptions::SocketOptions():
+  noDelay(false),
+  quickAck(false),
+  receiveBufferSize(0),
+  sendBufferSize(0),
+  busyPollMicroseconds(0),
+  typeOfService(0),
+  reusePort(false),
+  keepAlive(false),
+  keepAliveIdleSeconds(0),
+  keepAliveIntervalSeconds(0),
+  keepAliveCount(0) {}
+
+SocketOptions SocketOptions::lowLatency() {
+  SocketOptions options;
+  options.noDelay = true;
+  options.quickAck = true;
+  options.typeOfService = IPTOS_LOWDELAY;
+  options.keepAlive = true;
+  options.keepAliveIdleSeconds = 10;
+  options.keepAliveIntervalSeconds = 2;
+  options.keepAliveCount = 3;
+  return options;
+}
+
+SocketOptions SocketOptions::bulkThroughput() {
+  SocketOptions options;
+  options.receiveBufferSize = 4 * 1024 * 1024;
+  options.sendBufferSize = 4 * 1024 * 1024;
+  options.typeOfService = IPTOS_THROUGHPUT;
+  options.keepAlive = true;
+  options.keepAliveIdleSeconds = 60;
+  options.keepAliveIntervalSeconds = 10;
+  options.keepAliveCount = 6;
+  return options;
+}
+
+}}
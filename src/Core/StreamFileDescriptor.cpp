@@ -21,7 +21,9 @@
  * from me and not from my employer (Facebook).
  */
 
-#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -42,11 +44,17 @@ using std::string;
 using std::unique_ptr;
 
 StreamFileDescriptor::StreamFileDescriptor(int fd):
-  mFd(fd) {
+  mFd(fd),
+  mIsSocket(false),
+  mReceiveTimestamps(false),
+  mQuickAck(false) {
   if (fd < 0) {
     throw std::runtime_error(
         "Invalid descriptor in StreamFileDescriptor constructor");
   }
+  int type;
+  socklen_t length = sizeof type;
+  mIsSocket = getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &length) == 0;
 }
 
 StreamFileDescriptor::~StreamFileDescriptor() {
@@ -57,26 +65,109 @@ bool StreamFileDescriptor::isReadyForReading() const {
   return FileDescriptor::isReadyForReading(mFd);
 }
 
+int StreamFileDescriptor::getNativeHandle() const {
+  return mFd;
+}
+
 string StreamFileDescriptor::read() const {
   const int BUFF_SIZE = 4096;
   char buff[BUFF_SIZE];
   ssize_t rc = ::read(mFd, buff, BUFF_SIZE);
+  while (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    waitUntilReady(mFd, POLLIN, Deadline::max());
+    rc = ::read(mFd, buff, BUFF_SIZE);
+  }
   if (rc < 0) {
     throw std::runtime_error(std::strerror(errno));
   }
+  rearmQuickAck();
   return string(buff, static_cast<size_t>(rc));
 }
 
+string StreamFileDescriptor::readWithTimestamp(Timestamp& arrivalTime) const {
+  if (!mReceiveTimestamps) {
+    return FileDescriptor::readWithTimestamp(arrivalTime);
+  }
+  const int BUFF_SIZE = 4096;
+  char buff[BUFF_SIZE];
+  size_t size = receiveWithTimestamp(mFd, buff, BUFF_SIZE, 0, arrivalTime);
+  rearmQuickAck();
+  return string(buff, size);
+}
+
 void StreamFileDescriptor::write(const string& data) const {
+  writeWithDeadline(data, Deadline::max());
+}
+
+bool StreamFileDescriptor::waitForReading(Deadline deadline) const {
+  return waitUntilReady(mFd, POLLIN, deadline);
+}
+
+bool StreamFileDescriptor::writeWithDeadline(
+    const string& data,
+    Deadline deadline) const {
   const char* buff = data.c_str();
   size_t offset = 0;
   while (offset < data.size()) {
-    ssize_t rc = ::write(mFd, buff + offset, data.size() - offset);
+    ssize_t rc = writeSome(
+        buff + offset,
+        data.size() - offset,
+        deadline == Deadline::max());
+    if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (!waitUntilReady(mFd, POLLOUT, deadline)) {
+        return false;
+      }
+      continue;
+    }
     if (rc < 0) {
       throw std::runtime_error(std::strerror(errno));
     }
     offset += static_cast<size_t>(rc);
   }
+  return true;
+}
+
+ssize_t StreamFileDescriptor::writeSome(
+    const char* buff,
+    size_t size,
+    bool block) const {
+  if (mIsSocket) {
+    // A connection closed by the peer is reported as EPIPE, without raising
+    // SIGPIPE, so that the caller can handle it like any other error. Writes
+    // with a deadline must not block even if the socket is blocking.
+    return ::send(mFd, buff, size, MSG_NOSIGNAL | (block ? 0 : MSG_DONTWAIT));
+  }
+  return ::write(mFd, buff, size);
+}
+
+void StreamFileDescriptor::enableReceiveTimestamps() {
+  int enable = 1;
+  int rc = setsockopt(
+      mFd,
+      SOL_SOCKET,
+      SO_TIMESTAMPNS,
+      &enable,
+      sizeof enable);
+  if (rc != 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  mReceiveTimestamps = true;
+}
+
+void StreamFileDescriptor::setQuickAck(bool quickAck) {
+  mQuickAck = quickAck;
+  rearmQuickAck();
+}
+
+void StreamFileDescriptor::rearmQuickAck() const {
+  if (!mQuickAck) {
+    return;
+  }
+  int enable = 1;
+  int rc = setsockopt(mFd, IPPROTO_TCP, TCP_QUICKACK, &enable, sizeof enable);
+  if (rc != 0) {
+    LOGW("Could not set TCP_QUICKACK: ", std::strerror(errno));
+  }
 }
 
 unique_ptr<StreamFileDescriptor> StreamFileDescriptor::createOwnerOf(int fd) {
@@ -0,0 +1,122 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#include "LogMacro.h"
+
+#include "Core/Network.h"
+
+#include "Core/TcpAcceptorPool.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+using std::unique_ptr;
+
+// How often the threads check whether they should stop.
+static const std::chrono::milliseconds STOP_CHECK_INTERVAL(100);
+
+TcpAcceptorPool::TcpAcceptorPool(
+    const string& service,
+    size_t threadCount,
+    const Handler& handler,
+    const SocketOptions& options):
+  mHandler(handler),
+  mListeners(),
+  mThreads(),
+  mStopping(false) {
+  if (threadCount == 0) {
+    throw std::runtime_error("TcpAcceptorPool needs at least one thread");
+  }
+
+  SocketOptions reusePortOptions = options;
+  reusePortOptions.reusePort = true;
+
+  // The first listener picks the port if the service is "0".
+  mListeners.push_back(
+      Network::createTcpListener(service, SOMAXCONN, reusePortOptions));
+  string boundService = mListeners.front()->getLocalService();
+  while (mListeners.size() < threadCount) {
+    mListeners.push_back(
+        Network::createTcpListener(boundService, SOMAXCONN, reusePortOptions));
+  }
+
+  try {
+    for (const unique_ptr<ListeningFileDescriptor>& listener : mListeners) {
+      mThreads.emplace_back(
+          &TcpAcceptorPool::runThread,
+          this,
+          std::cref(*listener));
+    }
+  } catch (...) {
+    // Destroying joinable threads would terminate the process.
+    stop();
+    throw;
+  }
+}
+
+TcpAcceptorPool::~TcpAcceptorPool() {
+  stop();
+}
+
+void TcpAcceptorPool::stop() {
+  mStopping = true;
+  for (std::thread& thread : mThreads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+string TcpAcceptorPool::getLocalService() const {
+  return mListeners.front()->getLocalService();
+}
+
+void TcpAcceptorPool::runThread(const ListeningFileDescriptor& listener) {
+  while (!mStopping) {
+    unique_ptr<StreamFileDescriptor> fd;
+    try {
+      fd = listener.accept(
+          std::chrono::steady_clock::now() + STOP_CHECK_INTERVAL);
+    } catch (const std::exception& e) {
+      LOGE("Accepting a TCP connection failed: ", e.what());
+      // Errors like running out of descriptors do not go away immediately.
+      std::this_thread::sleep_for(STOP_CHECK_INTERVAL);
+      continue;
+    }
+    if (fd == nullptr) {
+      continue;
+    }
+    try {
+      mHandler(std::move(fd));
+    } catch (const std::exception& e) {
+      LOGE("Handling a TCP connection failed: ", e.what());
+    }
+  }
+}
+
+}}
@@ -22,6 +22,7 @@
  */
 
 #include <stdexcept>
+#include <utility>
 
 #include "Core/Network.h"
 
@@ -36,15 +37,49 @@ using std::swap;
 
 TcpClient::TcpClient():
   mFd(),
-  mLineBuffer() {}
-
-TcpClient::TcpClient(const std::string& host, const std::string& service):
-  mFd(Network::createTcpConnection(host, service)),
-  mLineBuffer(mFd) {}
+  mSendBuffer(),
+  mLineBuffer(),
+  mReceiver(),
+  mLatencyTracker() {}
+
+TcpClient::TcpClient(const std::shared_ptr<FileDescriptor>& fd):
+  mFd(fd),
+  mSendBuffer(),
+  mLineBuffer(mFd),
+  mReceiver(),
+  mLatencyTracker() {}
+
+TcpClient::TcpClient(
+    const std::string& host,
+    const std::string& service,
+    const SocketOptions& options):
+  mFd(Network::createTcpConnection(host, service, options)),
+  mSendBuffer(),
+  mLineBuffer(mFd),
+  mReceiver(),
+  mLatencyTracker() {}
+
+TcpClient::TcpClient(
+    const std::string& host,
+    const std::string& service,
+    std::chrono::milliseconds connectTimeout,
+    const SocketOptions& options):
+  mFd(Network::createTcpConnection(
+      host,
+      service,
+      options,
+      std::chrono::steady_clock::now() + connectTimeout)),
+  mSendBuffer(),
+  mLineBuffer(mFd),
+  mReceiver(),
+  mLatencyTracker() {}
 
 TcpClient::TcpClient(TcpClient&& other):
   mFd(),
-  mLineBuffer() {
+  mSendBuffer(),
+  mLineBuffer(),
+  mReceiver(),
+  mLatencyTracker() {
   swapWith(other);
 }
 
@@ -55,38 +90,143 @@ TcpClient& TcpClient::operator = (TcpClient&& other) {
 
 void TcpClient::swapWith(TcpClient& other) {
   swap(mFd, other.mFd);
+  swap(mSendBuffer, other.mSendBuffer);
   swap(mLineBuffer, other.mLineBuffer);
+  swap(mReceiver, other.mReceiver);
+  swap(mLatencyTracker, other.mLatencyTracker);
 }
 
 bool TcpClient::isConnected() const {
-  return mLineBuffer.isInitialized();
+  return mFd != nullptr;
+}
+
+int TcpClient::getNativeHandle() const {
+  if (!isConnected()) {
+    return -1;
+  }
+  return mFd->getNativeHandle();
+}
+
+void TcpClient::startBackgroundReceiver() {
+  if (!isConnected()) {
+    throw std::runtime_error(
+        "startBackgroundReceiver called on a disconnected TcpSocket");
+  }
+  if (mReceiver == nullptr) {
+    // The receiver takes over the chars that were already buffered.
+    mReceiver.reset(new BackgroundReceiver(std::move(mLineBuffer)));
+  }
+}
+
+bool TcpClient::hasBackgroundReceiver() const {
+  return mReceiver != nullptr;
+}
+
+void TcpClient::setLatencyTracker(
+    const std::shared_ptr<LatencyTracker>& tracker) {
+  mLatencyTracker = tracker;
 }
 
 void TcpClient::sendLine(const string& line) {
-  sendRaw(line + "\n");
+  mSendBuffer.clear();
+  mSendBuffer.append(line);
+  mSendBuffer.append('\n');
+  sendRaw(mSendBuffer.getData());
 }
 
 void TcpClient::sendRaw(const string& data) {
   if (!isConnected()) {
     throw std::runtime_error("send called on a disconnected TcpSocket");
   }
+  if (mLatencyTracker != nullptr) {
+    mLatencyTracker->dataSent(data);
+  }
   mFd->write(data);
 }
 
+bool TcpClient::sendLine(
+    const string& line,
+    FileDescriptor::Deadline deadline) {
+  mSendBuffer.clear();
+  mSendBuffer.append(line);
+  mSendBuffer.append('\n');
+  return sendRaw(mSendBuffer.getData(), deadline);
+}
+
+bool TcpClient::sendRaw(const string& data, FileDescriptor::Deadline deadline) {
+  if (!isConnected()) {
+    throw std::runtime_error("send called on a disconnected TcpSocket");
+  }
+  if (mLatencyTracker != nullptr) {
+    mLatencyTracker->dataSent(data);
+  }
+  return mFd->writeWithDeadline(data, deadline);
+}
+
 size_t TcpClient::charsReady() {
+  checkNoBackgroundReceiver("charsReady");
   return mLineBuffer.charsReady();
 }
 
 size_t TcpClient::linesReady() {
+  if (mReceiver != nullptr) {
+    return mReceiver->linesReady();
+  }
   return mLineBuffer.linesReady();
 }
 
 char TcpClient::getChar() {
+  checkNoBackgroundReceiver("getChar");
   return mLineBuffer.getChar();
 }
 
 string TcpClient::getLine() {
-  return mLineBuffer.getLine();
+  string line;
+  if (mReceiver != nullptr) {
+    line = mReceiver->getLine();
+  } else {
+    line = mLineBuffer.getLine();
+  }
+  if (mLatencyTracker != nullptr) {
+    mLatencyTracker->lineReceived(line);
+  }
+  return line;
+}
+
+size_t TcpClient::linesBuffered() const {
+  checkNoBackgroundReceiver("linesBuffered");
+  return mLineBuffer.linesBuffered();
+}
+
+void TcpClient::readOnce() {
+  checkNoBackgroundReceiver("readOnce");
+  mLineBuffer.readOnce();
+}
+
+bool TcpClient::getChar(char& ch, FileDescriptor::Deadline deadline) {
+  checkNoBackgroundReceiver("getChar");
+  return mLineBuffer.getChar(ch, deadline);
+}
+
+bool TcpClient::getLine(string& line, FileDescriptor::Deadline deadline) {
+  bool received;
+  if (mReceiver != nullptr) {
+    received = mReceiver->getLine(line, deadline);
+  } else {
+    received = mLineBuffer.getLine(line, deadline);
+  }
+  if (received && mLatencyTracker != nullptr) {
+    mLatencyTracker->lineReceived(line);
+  }
+  return received;
+}
+
+void TcpClient::checkNoBackgroundReceiver(const char* function) const {
+  if (mReceiver != nullptr) {
+    throw std::runtime_error(
+        std::string(function) +
+        " is not available with a background receiver");
+  }
 }
 
 void swap(TcpClient& client1, TcpClient& client2) {
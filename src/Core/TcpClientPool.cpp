@@ -0,0 +1,182 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "LogMacro.h"
+
+#include "Core/Network.h"
+
+#include "Core/TcpClientPool.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+
+TcpClientPool::TcpClientPool(
+    const string& host,
+    const string& service,
+    const SocketOptions& options):
+  mHost(host),
+  mService(service),
+  mOptions(options),
+  mHandshake(),
+  mConnectTimeout(5000),
+  mMutex(),
+  mClientReady(),
+  mReady(),
+  mConnectingCount(0),
+  mFailedCount(0),
+  mThreads(),
+  mFinishedThreads() {}
+
+TcpClientPool::~TcpClientPool() {
+  for (std::thread& thread : mThreads) {
+    thread.join();
+  }
+}
+
+void TcpClientPool::setHandshake(const Handshake& handshake) {
+  mHandshake = handshake;
+}
+
+void TcpClientPool::setConnectTimeout(std::chrono::milliseconds timeout) {
+  mConnectTimeout = timeout;
+}
+
+void TcpClientPool::warmUp(size_t count) {
+  // Resolved once here, the connecting threads then find the address in the
+  // resolver cache.
+  Network::prefetch(mHost, mService);
+  joinFinishedThreads();
+  for (size_t i = 0; i < count; ++i) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      ++mConnectingCount;
+    }
+    try {
+      mThreads.emplace_back(&TcpClientPool::connect, this);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      --mConnectingCount;
+      mClientReady.notify_all();
+      throw;
+    }
+  }
+}
+
+TcpClient TcpClientPool::acquire() {
+  TcpClient client;
+  if (!acquire(client, FileDescriptor::Deadline::max())) {
+    throw std::runtime_error(
+        "No connection to " + mHost + ":" + mService + " is available");
+  }
+  return client;
+}
+
+bool TcpClientPool::acquire(
+    TcpClient& client,
+    FileDescriptor::Deadline deadline) {
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (mReady.empty() && mConnectingCount > 0) {
+    if (deadline == FileDescriptor::Deadline::max()) {
+      mClientReady.wait(lock);
+    } else if (mClientReady.wait_until(lock, deadline) ==
+        std::cv_status::timeout) {
+      break;
+    }
+  }
+  if (mReady.empty()) {
+    return false;
+  }
+  client = std::move(mReady.front());
+  mReady.pop_front();
+  return true;
+}
+
+size_t TcpClientPool::getReadyCount() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mReady.size();
+}
+
+size_t TcpClientPool::getConnectingCount() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mConnectingCount;
+}
+
+size_t TcpClientPool::getFailedCount() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mFailedCount;
+}
+
+void TcpClientPool::connect() {
+  TcpClient client;
+  try {
+    client = TcpClient(mHost, mService, mConnectTimeout, mOptions);
+    if (client.isConnected() && mHandshake) {
+      mHandshake(client);
+    }
+  } catch (const std::exception& e) {
+    LOGW("Connecting to ", mHost, ":", mService, " failed: ", e.what());
+    client = TcpClient();
+  } catch (...) {
+    LOGW("Connecting to ", mHost, ":", mService, " failed");
+    client = TcpClient();
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  --mConnectingCount;
+  if (client.isConnected()) {
+    mReady.push_back(std::move(client));
+  } else {
+    ++mFailedCount;
+  }
+  mFinishedThreads.push_back(std::this_thread::get_id());
+  mClientReady.notify_all();
+}
+
+void TcpClientPool::joinFinishedThreads() {
+  std::vector<std::thread::id> finished;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    finished.swap(mFinishedThreads);
+  }
+  for (std::thread::id id : finished) {
+    auto it = std::find_if(
+        mThreads.begin(),
+        mThreads.end(),
+        [id](const std::thread& thread) { return thread.get_id() == id; });
+    it->join();
+    mThreads.erase(it);
+  }
+}
+
+}}
@@ -0,0 +1,126 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <memory>
+#include <utility>
+
+#include "Core/TcpPipeline.h"
+
+namespace MarathonKit {
+namespace Core {
+
+using std::string;
+
+TcpPipeline::TcpPipeline(TcpClient& client):
+  mClient(client),
+  mQueuedCommands(),
+  mQueuedCallbacks(),
+  mPendingCallbacks() {}
+
+void TcpPipeline::enqueue(const string& command, const Callback& callback) {
+  mQueuedCommands += command;
+  mQueuedCommands += '\n';
+  mQueuedCallbacks.push_back(callback);
+}
+
+std::future<string> TcpPipeline::enqueue(const string& command) {
+  auto promise = std::make_shared<std::promise<string>>();
+  enqueue(command, [promise](const string& response) {
+    promise->set_value(response);
+  });
+  return promise->get_future();
+}
+
+void TcpPipeline::flush() {
+  if (mQueuedCallbacks.empty()) {
+    return;
+  }
+  mClient.sendRaw(mQueuedCommands);
+  markQueuedAsPending();
+}
+
+bool TcpPipeline::flush(FileDescriptor::Deadline deadline) {
+  if (mQueuedCallbacks.empty()) {
+    return true;
+  }
+  bool sent = mClient.sendRaw(mQueuedCommands, deadline);
+  // Part of the commands may have been sent even if the deadline passed, so
+  // they cannot be sent again.
+  markQueuedAsPending();
+  return sent;
+}
+
+size_t TcpPipeline::processResponses() {
+  size_t completed = 0;
+  while (!mPendingCallbacks.empty() && mClient.linesReady() > 0) {
+    complete(mClient.getLine());
+    ++completed;
+  }
+  return completed;
+}
+
+void TcpPipeline::waitForAll() {
+  flush();
+  while (!mPendingCallbacks.empty()) {
+    complete(mClient.getLine());
+  }
+}
+
+bool TcpPipeline::waitForAll(FileDescriptor::Deadline deadline) {
+  if (!flush(deadline)) {
+    return false;
+  }
+  while (!mPendingCallbacks.empty()) {
+    string response;
+    if (!mClient.getLine(response, deadline)) {
+      return false;
+    }
+    complete(response);
+  }
+  return true;
+}
+
+size_t TcpPipeline::getQueuedCount() const {
+  return mQueuedCallbacks.size();
+}
+
+size_t TcpPipeline::getPendingCount() const {
+  return mPendingCallbacks.size();
+}
+
+void TcpPipeline::markQueuedAsPending() {
+  mQueuedCommands.clear();
+  while (!mQueuedCallbacks.empty()) {
+    mPendingCallbacks.push_back(std::move(mQueuedCallbacks.front()));
+    mQueuedCallbacks.pop_front();
+  }
+}
+
+void TcpPipeline::complete(const string& response) {
+  // The callback may enqueue more commands, so remove it first.
+  Callback callback = std::move(mPendingCallbacks.front());
+  mPendingCallbacks.pop_front();
+  callback(response);
+}
+
+}}
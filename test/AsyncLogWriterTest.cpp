@@ -0,0 +1,77 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "Core/AsyncLogWriter.h"
+
+using MarathonKit::Core::AsyncLogWriter;
+using MarathonKit::Core::Log;
+using std::string;
+
+TEST(AsyncLogWriterTest, flushWaitsForOwnRecordWithSeveralProducers) {
+  const int THREADS = 4;
+  const int COUNT = 500;
+  std::mutex mutex;
+  std::set<string> written;
+  AsyncLogWriter writer(
+      16,
+      Log::OverflowPolicy::BLOCK,
+      [&](const string& batch) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t begin = 0;
+        size_t end;
+        while ((end = batch.find('\n', begin)) != string::npos) {
+          written.insert(batch.substr(begin, end - begin));
+          begin = end + 1;
+        }
+      });
+
+  std::vector<int> missing(THREADS, 0);
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < THREADS; ++thread) {
+    threads.emplace_back([&, thread]() {
+      for (int i = 0; i < COUNT; ++i) {
+        string record = std::to_string(thread) + " " + std::to_string(i);
+        writer.push(record + "\n");
+        writer.flush();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (written.count(record) == 0) {
+          ++missing[thread];
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_THAT(missing, testing::Each(0));
+  EXPECT_EQ(THREADS * COUNT, written.size());
+}
@@ -0,0 +1,198 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <poll.h>
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "Core/Coroutine.h"
+#include "Core/EventLoop.h"
+#include "Core/StreamFileDescriptor.h"
+#include "Core/TcpClient.h"
+
+#include "ConnectedPair.h"
+
+using MarathonKit::Core::EventLoop;
+using MarathonKit::Core::StreamFileDescriptor;
+using MarathonKit::Core::TcpClient;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+class EventLoopTest : public testing::Test {
+protected:
+
+  EventLoopTest():
+    mLoop(),
+    mClients(),
+    mServers() {}
+
+  void addSession() {
+    StreamPair pair;
+    mClients.emplace_back(shared_ptr<StreamFileDescriptor>(
+        std::move(pair.first)));
+    mServers.push_back(std::move(pair.second));
+  }
+
+  EventLoop mLoop;
+  vector<TcpClient> mClients;
+  vector<unique_ptr<StreamFileDescriptor>> mServers;
+
+};
+
+TEST_F(EventLoopTest, runsCallbackOfReadyDescriptorOnce) {
+  addSession();
+  addSession();
+  int calls = 0;
+  mLoop.watch(mClients[0].getNativeHandle(), POLLIN, [&calls]() { ++calls; });
+  mLoop.watch(mClients[1].getNativeHandle(), POLLIN, [&calls]() { ++calls; });
+
+  EXPECT_FALSE(mLoop.runOnce(std::chrono::steady_clock::now()));
+
+  mServers[1]->write("x");
+  EXPECT_TRUE(mLoop.runOnce(std::chrono::steady_clock::now()));
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(1, mLoop.getWatchCount());
+
+  EXPECT_FALSE(mLoop.runOnce(std::chrono::steady_clock::now()));
+  EXPECT_EQ(1, calls);
+}
+
+TEST_F(EventLoopTest, callbacksCanWatchAgain) {
+  addSession();
+  mServers[0]->write("x");
+  int calls = 0;
+  std::function<void()> callback = [&]() {
+    if (++calls < 3) {
+      mLoop.watch(mClients[0].getNativeHandle(), POLLIN, callback);
+    }
+  };
+  mLoop.watch(mClients[0].getNativeHandle(), POLLIN, callback);
+
+  mLoop.run();
+
+  EXPECT_EQ(3, calls);
+  EXPECT_TRUE(mLoop.isEmpty());
+}
+
+TEST_F(EventLoopTest, keepsWatchesThatDidNotRunWhenCallbackThrows) {
+  addSession();
+  addSession();
+  int calls = 0;
+  auto callback = [&calls]() {
+    if (++calls == 1) {
+      throw std::runtime_error("callback failed");
+    }
+  };
+  mLoop.watch(mClients[0].getNativeHandle(), POLLIN, callback);
+  mLoop.watch(mClients[1].getNativeHandle(), POLLIN, callback);
+
+  mServers[0]->write("x");
+  mServers[1]->write("x");
+  EXPECT_THROW(
+      mLoop.runOnce(std::chrono::steady_clock::now()),
+      std::runtime_error);
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(1, mLoop.getWatchCount());
+
+  EXPECT_TRUE(mLoop.runOnce(std::chrono::steady_clock::now()));
+  EXPECT_EQ(2, calls);
+  EXPECT_TRUE(mLoop.isEmpty());
+}
+
+#ifdef MARATHON_KIT_HAS_COROUTINES
+
+using MarathonKit::Core::Task;
+using MarathonKit::Core::asyncGetLine;
+using MarathonKit::Core::asyncSendLine;
+
+static Task echo(EventLoop& loop, TcpClient& client, int count) {
+  for (int i = 0; i < count; ++i) {
+    string line = co_await asyncGetLine(loop, client);
+    co_await asyncSendLine(loop, client, "echo " + line);
+  }
+}
+
+static Task echoTwice(EventLoop& loop, TcpClient& client) {
+  co_await echo(loop, client, 1);
+  co_await echo(loop, client, 1);
+}
+
+TEST_F(EventLoopTest, runsManySessionsAsCoroutines) {
+  const int SESSIONS = 20;
+  vector<Task> tasks;
+  for (int i = 0; i < SESSIONS; ++i) {
+    addSession();
+  }
+  for (int i = 0; i < SESSIONS; ++i) {
+    tasks.push_back(echo(mLoop, mClients[i], 2));
+  }
+  EXPECT_EQ(SESSIONS, mLoop.getWatchCount());
+
+  for (int i = 0; i < SESSIONS; ++i) {
+    // The line arrives in two parts.
+    mServers[i]->write("a");
+    mServers[i]->write(std::to_string(i) + "\nb\n");
+  }
+  mLoop.run();
+
+  for (int i = 0; i < SESSIONS; ++i) {
+    EXPECT_TRUE(tasks[i].isDone());
+    tasks[i].check();
+    TcpClient server(shared_ptr<StreamFileDescriptor>(std::move(mServers[i])));
+    EXPECT_EQ("echo a" + std::to_string(i), server.getLine());
+    EXPECT_EQ("echo b", server.getLine());
+  }
+}
+
+TEST_F(EventLoopTest, coroutinesCanAwaitEachOther) {
+  addSession();
+  Task task = echoTwice(mLoop, mClients[0]);
+  mServers[0]->write("1\n2\n");
+  mLoop.run();
+
+  EXPECT_TRUE(task.isDone());
+  TcpClient server(shared_ptr<StreamFileDescriptor>(std::move(mServers[0])));
+  EXPECT_EQ("echo 1", server.getLine());
+  EXPECT_EQ("echo 2", server.getLine());
+}
+
+TEST_F(EventLoopTest, closedConnectionIsThrownInsideCoroutine) {
+  addSession();
+  Task task = echo(mLoop, mClients[0], 1);
+  mServers[0].reset();
+  mLoop.run();
+
+  EXPECT_TRUE(task.isDone());
+  EXPECT_THROW(task.check(), std::runtime_error);
+}
+
+#endif
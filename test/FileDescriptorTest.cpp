@@ -0,0 +1,100 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+
+#include <gmock/gmock.h>
+
+#include "Core/FileDescriptor.h"
+
+using MarathonKit::Core::FileDescriptor;
+
+// Implements only what a subclass has to, to exercise the defaults.
+class MinimalFileDescriptor : public FileDescriptor {
+public:
+
+  MinimalFileDescriptor(int fd, int readyAfter):
+    mFd(fd),
+    mReadyAfter(readyAfter),
+    mChecks(0) {}
+
+  virtual bool isReadyForReading() const {
+    return ++mChecks > mReadyAfter;
+  }
+
+  virtual std::string read() const {
+    return std::string();
+  }
+
+  virtual void write(const std::string&) const {}
+
+  virtual int getNativeHandle() const {
+    return mFd;
+  }
+
+  int getChecks() const {
+    return mChecks;
+  }
+
+private:
+
+  const int mFd;
+  const int mReadyAfter;
+  mutable int mChecks;
+
+};
+
+TEST(FileDescriptorTest, waitForReadingPollsNativeHandle) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  MinimalFileDescriptor fd(fds[0], 0);
+
+  EXPECT_FALSE(fd.waitForReading(
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(5)));
+  ASSERT_EQ(1, ::write(fds[1], "a", 1));
+  EXPECT_TRUE(fd.waitForReading(FileDescriptor::Deadline::max()));
+  EXPECT_EQ(0, fd.getChecks());
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(FileDescriptorTest, waitForReadingFallsBackToReadinessChecks) {
+  MinimalFileDescriptor fd(-1, 3);
+
+  EXPECT_TRUE(fd.waitForReading(FileDescriptor::Deadline::max()));
+  EXPECT_EQ(4, fd.getChecks());
+}
+
+TEST(FileDescriptorTest, waitForReadingStopsAtDeadline) {
+  MinimalFileDescriptor fd(-1, 1000000);
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(fd.waitForReading(start + std::chrono::milliseconds(5)));
+  EXPECT_GE(
+      std::chrono::steady_clock::now(),
+      start + std::chrono::milliseconds(5));
+}
@@ -0,0 +1,167 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "Core/ImpairedFileDescriptor.h"
+#include "Core/MessageFileDescriptor.h"
+
+#include "ConnectedPair.h"
+
+using MarathonKit::Core::ImpairedFileDescriptor;
+using MarathonKit::Core::MessageFileDescriptor;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+typedef ImpairedFileDescriptor::Impairment Impairment;
+
+static std::chrono::steady_clock::duration measure(
+    const std::function<void()>& function) {
+  auto start = std::chrono::steady_clock::now();
+  function();
+  return std::chrono::steady_clock::now() - start;
+}
+
+class ImpairedFileDescriptorTest : public testing::Test {
+protected:
+
+  ImpairedFileDescriptorTest():
+    mLocal(),
+    mRemote() {}
+
+  template <typename Pair>
+  void connect() {
+    Pair pair;
+    mLocal = std::move(pair.first);
+    mRemote = std::move(pair.second);
+  }
+
+  shared_ptr<MarathonKit::Core::FileDescriptor> mLocal;
+  shared_ptr<MarathonKit::Core::FileDescriptor> mRemote;
+
+};
+
+TEST_F(ImpairedFileDescriptorTest, delaysReceivedData) {
+  connect<StreamPair>();
+  Impairment impairment;
+  impairment.delay = std::chrono::milliseconds(30);
+  ImpairedFileDescriptor fd(mLocal, impairment);
+
+  mRemote->write("data");
+  EXPECT_FALSE(fd.isReadyForReading());
+  string data;
+  auto elapsed = measure([&]() { data = fd.read(); });
+
+  EXPECT_EQ("data", data);
+  EXPECT_GE(elapsed, std::chrono::milliseconds(25));
+}
+
+TEST_F(ImpairedFileDescriptorTest, delayStartsWhenDataArrives) {
+  MessagePair pair;
+  pair.first->enableReceiveTimestamps();
+  shared_ptr<MessageFileDescriptor> local(std::move(pair.first));
+  mRemote = std::move(pair.second);
+  Impairment impairment;
+  impairment.delay = std::chrono::milliseconds(50);
+  ImpairedFileDescriptor fd(local, impairment);
+
+  mRemote->write("data");
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  string data;
+  auto elapsed = measure([&]() { data = fd.read(); });
+
+  EXPECT_EQ("data", data);
+  EXPECT_LT(elapsed, std::chrono::milliseconds(35));
+}
+
+TEST_F(ImpairedFileDescriptorTest, fragmentsChunks) {
+  connect<StreamPair>();
+  Impairment impairment;
+  impairment.maxChunkSize = 2;
+  ImpairedFileDescriptor fd(mLocal, impairment);
+
+  mRemote->write("abcde");
+
+  EXPECT_EQ("ab", fd.read());
+  EXPECT_EQ("cd", fd.read());
+  EXPECT_EQ("e", fd.read());
+}
+
+TEST_F(ImpairedFileDescriptorTest, capsSendBandwidth) {
+  connect<StreamPair>();
+  Impairment impairment;
+  impairment.bitsPerSecond = 80000;
+  impairment.maxChunkSize = 100;
+  ImpairedFileDescriptor fd(mLocal, impairment);
+
+  // 500 bytes at 10 kB/s take 50 ms.
+  auto elapsed = measure([&]() { fd.write(string(500, 'x')); });
+
+  EXPECT_GE(elapsed, std::chrono::milliseconds(45));
+  EXPECT_EQ(500, mRemote->read().size());
+}
+
+TEST_F(ImpairedFileDescriptorTest, reordersDatagrams) {
+  connect<MessagePair>();
+  Impairment impairment;
+  impairment.reorderProbability = 0.5;
+  impairment.seed = 42;
+  ImpairedFileDescriptor fd(mLocal, impairment);
+
+  vector<string> sent;
+  for (int i = 0; i < 20; ++i) {
+    sent.push_back(std::to_string(i));
+    mRemote->write(sent.back());
+  }
+  vector<string> received;
+  for (int i = 0; i < 20; ++i) {
+    received.push_back(fd.read());
+  }
+
+  EXPECT_NE(sent, received);
+  std::sort(sent.begin(), sent.end());
+  std::sort(received.begin(), received.end());
+  EXPECT_EQ(sent, received);
+}
+
+TEST_F(ImpairedFileDescriptorTest, reportsClosedConnection) {
+  connect<StreamPair>();
+  ImpairedFileDescriptor fd(mLocal, Impairment());
+
+  mRemote->write("last");
+  mRemote.reset();
+
+  EXPECT_EQ("last", fd.read());
+  EXPECT_TRUE(fd.waitForReading(std::chrono::steady_clock::now()));
+  EXPECT_EQ("", fd.read());
+}
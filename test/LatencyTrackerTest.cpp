@@ -0,0 +1,119 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <gmock/gmock.h>
+
+#include "Core/LatencyTracker.h"
+#include "Core/StreamFileDescriptor.h"
+#include "Core/TcpClient.h"
+
+#include "ConnectedPair.h"
+
+using MarathonKit::Core::LatencyTracker;
+using MarathonKit::Core::StreamFileDescriptor;
+using MarathonKit::Core::TcpClient;
+using std::shared_ptr;
+using std::string;
+
+TEST(LatencyTrackerTest, histogramUsesPowersOfTwo) {
+  LatencyTracker::Histogram histogram;
+  histogram.add(100);
+  histogram.add(200);
+  histogram.add(300);
+  histogram.add(5000);
+
+  EXPECT_EQ(4, histogram.getCount());
+  EXPECT_EQ(100, histogram.getMin());
+  EXPECT_EQ(5000, histogram.getMax());
+  EXPECT_DOUBLE_EQ(1400.0, histogram.getMean());
+  EXPECT_EQ(256, histogram.getPercentile(50.0));
+  EXPECT_EQ(5000, histogram.getPercentile(99.0));
+}
+
+TEST(LatencyTrackerTest, groupsCommandsByFirstWord) {
+  LatencyTracker tracker;
+  tracker.dataSent("MOVE 1 2\nLOOK\n");
+  tracker.dataSent("MOVE 3 4\n");
+  tracker.lineReceived("OK");
+  tracker.lineReceived("OK");
+  tracker.lineReceived("OK");
+
+  const auto& histograms = tracker.getHistograms();
+  ASSERT_EQ(2, histograms.size());
+  EXPECT_EQ(2, histograms.at("MOVE").getCount());
+  EXPECT_EQ(1, histograms.at("LOOK").getCount());
+}
+
+TEST(LatencyTrackerTest, skipsLinesRejectedByMatcher) {
+  LatencyTracker tracker;
+  tracker.setMatcher([](const string& line) {
+    return line.compare(0, 5, "EVENT") != 0;
+  });
+  tracker.setClassifier([](const string&) { return string("ANY"); });
+  tracker.dataSent("A\n");
+  tracker.lineReceived("EVENT");
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  tracker.lineReceived("OK");
+
+  const auto& histogram = tracker.getHistograms().at("ANY");
+  EXPECT_EQ(1, histogram.getCount());
+  EXPECT_GE(histogram.getMin(), 2000000);
+}
+
+TEST(LatencyTrackerTest, keepsMatchingWhenQueueOverflows) {
+  LatencyTracker tracker(2);
+  tracker.dataSent("A\nB\nC\n");
+  tracker.lineReceived("OK");
+  tracker.lineReceived("OK");
+  tracker.dataSent("D\n");
+  tracker.lineReceived("OK");
+  tracker.lineReceived("OK");
+
+  const auto& histograms = tracker.getHistograms();
+  EXPECT_EQ(1, histograms.at("A").getCount());
+  EXPECT_EQ(1, histograms.at("B").getCount());
+  EXPECT_EQ(0, histograms.count("C"));
+  EXPECT_EQ(1, histograms.at("D").getCount());
+}
+
+TEST(LatencyTrackerTest, measuresTcpClientCommands) {
+  StreamPair pair;
+  TcpClient client(shared_ptr<StreamFileDescriptor>(std::move(pair.first)));
+  TcpClient server(shared_ptr<StreamFileDescriptor>(std::move(pair.second)));
+  auto tracker = std::make_shared<LatencyTracker>();
+  client.setLatencyTracker(tracker);
+
+  client.sendFields("PING", 1);
+  EXPECT_EQ("PING 1", server.getLine());
+  server.sendLine("PONG");
+  EXPECT_EQ("PONG", client.getLine());
+
+  EXPECT_EQ(1, tracker->getHistograms().at("PING").getCount());
+  tracker->dump();
+}
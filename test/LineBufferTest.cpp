@@ -21,21 +21,28 @@
  * from me and not from my employer (Facebook).
  */
 
+#include <chrono>
 #include <memory>
+#include <stdexcept>
 #include <utility>
 
 #include <gmock/gmock.h>
 
 #include "Core/LineBuffer.h"
 
+#include "ConnectedPair.h"
 #include "MockFileDescriptor.h"
 
+using MarathonKit::Core::FileDescriptor;
 using MarathonKit::Core::LineBuffer;
 using std::make_shared;
 using std::shared_ptr;
 using std::swap;
+using testing::DoAll;
 using testing::InSequence;
 using testing::Return;
+using testing::SetArgReferee;
+using testing::_;
 
 TEST(LineBufferTest, noDataAvailable) {
   shared_ptr<MockFileDescriptor> fd = make_shared<MockFileDescriptor>();
@@ -364,3 +371,87 @@ TEST(LineBufferTest, isMovable) {
   EXPECT_EQ("efgh", lineBuffer2.getLine());
   EXPECT_EQ(0, lineBuffer2.linesReady());
 }
+
+TEST(LineBufferTest, reportsArrivalTimeOfFirstByte) {
+  shared_ptr<MockTimestampedFileDescriptor> fd =
+      make_shared<MockTimestampedFileDescriptor>();
+  LineBuffer lineBuffer(fd);
+
+  FileDescriptor::Timestamp time1(std::chrono::seconds(1));
+  FileDescriptor::Timestamp time2(std::chrono::seconds(2));
+  FileDescriptor::Timestamp time3(std::chrono::seconds(3));
+
+  {
+    InSequence seq;
+
+    EXPECT_CALL(*fd, readWithTimestamp(_))
+      .WillOnce(DoAll(SetArgReferee<0>(time1), Return("ab")));
+    EXPECT_CALL(*fd, readWithTimestamp(_))
+      .WillOnce(DoAll(SetArgReferee<0>(time2), Return("cd\nef")));
+    EXPECT_CALL(*fd, readWithTimestamp(_))
+      .WillOnce(DoAll(SetArgReferee<0>(time3), Return("\ngh\n")));
+  }
+
+  FileDescriptor::Timestamp arrivalTime;
+
+  EXPECT_EQ("abcd", lineBuffer.getLine(arrivalTime));
+  EXPECT_TRUE(arrivalTime == time1);
+
+  EXPECT_EQ("ef", lineBuffer.getLine(arrivalTime));
+  EXPECT_TRUE(arrivalTime == time2);
+
+  EXPECT_EQ("gh", lineBuffer.getLine(arrivalTime));
+  EXPECT_TRUE(arrivalTime == time3);
+}
+
+TEST(LineBufferTest, getLineStopsAtDeadline) {
+  shared_ptr<MockFileDescriptor> fd = make_shared<MockFileDescriptor>();
+  LineBuffer lineBuffer(fd);
+
+  FileDescriptor::Deadline deadline = std::chrono::steady_clock::now();
+
+  {
+    InSequence seq;
+
+    EXPECT_CALL(*fd, waitForReading(deadline))
+      .WillOnce(Return(true));
+    EXPECT_CALL(*fd, read())
+      .WillOnce(Return("ab"));
+    EXPECT_CALL(*fd, waitForReading(deadline))
+      .WillOnce(Return(false));
+  }
+
+  std::string line;
+  EXPECT_FALSE(lineBuffer.getLine(line, deadline));
+
+  {
+    InSequence seq;
+
+    EXPECT_CALL(*fd, waitForReading(deadline))
+      .WillOnce(Return(true));
+    EXPECT_CALL(*fd, read())
+      .WillOnce(Return("cd\n"));
+  }
+
+  EXPECT_TRUE(lineBuffer.getLine(line, deadline));
+  EXPECT_EQ("abcd", line);
+}
+
+TEST(LineBufferTest, skipsEmptyDatagrams) {
+  MessagePair pair;
+  LineBuffer lineBuffer(shared_ptr<FileDescriptor>(std::move(pair.first)));
+
+  pair.second->write("");
+  pair.second->write("ab\n");
+
+  EXPECT_EQ("ab", lineBuffer.getLine());
+}
+
+TEST(LineBufferTest, throwsWhenStreamIsClosed) {
+  StreamPair pair;
+  LineBuffer lineBuffer(shared_ptr<FileDescriptor>(std::move(pair.first)));
+
+  pair.second.reset();
+
+  EXPECT_THROW(lineBuffer.getLine(), std::runtime_error);
+}
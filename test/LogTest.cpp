@@ -0,0 +1,408 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "DebugMacro.h"
+#include "LogMacro.h"
+
+#include "Core/Log.h"
+
+using MarathonKit::Core::Log;
+using std::string;
+
+class LogTest : public testing::Test {
+protected:
+
+  LogTest():
+    mPath("/tmp/MarathonKitTest-log-" + std::to_string(getpid())),
+    mSavedStderr(-1) {}
+
+  // The records still go to stderr as well, which would flood the test
+  // output, so it is silenced for the duration of a test.
+  virtual void SetUp() {
+    unlink(mPath.c_str());
+    Log::setLogFile(mPath);
+    mSavedStderr = dup(STDERR_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDERR_FILENO);
+    close(devNull);
+  }
+
+  virtual void TearDown() {
+    Log::disableAsync();
+    Log::disableDeferredFormatting();
+    Log::setMinLogLevel(Log::Level::DEBUG);
+    Log::setTimestampPrecision(Log::TimestampPrecision::SECONDS);
+    dup2(mSavedStderr, STDERR_FILENO);
+    close(mSavedStderr);
+    unlink(mPath.c_str());
+  }
+
+  std::vector<string> readLogFile() {
+    std::ifstream file(mPath);
+    std::vector<string> lines;
+    string line;
+    while (std::getline(file, line)) {
+      lines.push_back(line);
+    }
+    return lines;
+  }
+
+  string mPath;
+  int mSavedStderr;
+
+};
+
+// Everything after the timestamp, level, thread and sequence number.
+static string stripHeader(const string& line) {
+  size_t sequence = line.find(" #");
+  return line.substr(line.find(' ', sequence + 1) + 1);
+}
+
+// The sequence number of a record.
+static uint64_t getSequenceNumber(const string& line) {
+  return std::stoull(line.substr(line.find(" #") + 2));
+}
+
+struct Point {
+  int x;
+  int y;
+};
+
+static std::ostream& operator << (std::ostream& outputStream, const Point& p) {
+  return outputStream << '[' << p.x << ',' << p.y << ']';
+}
+
+static void logSample(const string& text) {
+  char letters[8] = "abc";
+  LOGW(
+      text,
+      ' ',
+      -42,
+      ' ',
+      3.25,
+      ' ',
+      static_cast<uint64_t>(1) << 40,
+      " literal ",
+      letters,
+      ' ',
+      text.c_str());
+}
+
+TEST_F(LogTest, writesSynchronouslyByDefault) {
+  LOGI("hello ", 42);
+
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(1, lines.size());
+  EXPECT_THAT(lines[0], testing::EndsWith("\thello 42"));
+  EXPECT_THAT(lines[0], testing::HasSubstr(" INFO "));
+}
+
+TEST_F(LogTest, filteredRecordDoesNotEvaluateArguments) {
+  int evaluated = 0;
+  Log::setMinLogLevel(Log::Level::INFO);
+
+  if (evaluated == 0)
+    LOGD(++evaluated);
+  else
+    LOGE("unreachable");
+  DEBUG(++evaluated);
+
+  EXPECT_EQ(0, evaluated);
+  EXPECT_EQ(0, readLogFile().size());
+}
+
+TEST_F(LogTest, includesCallSite) {
+  Log("Foo.cpp", 12).w("warning");
+  DEBUG(1, "two");
+  std::unique_ptr<Log> copy;
+  {
+    string file = "Bar.cpp";
+    Log log(file, 34);
+    file = "overwritten";
+    copy.reset(new Log(log));
+  }
+  copy->i("copied");
+
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(3, lines.size());
+  EXPECT_THAT(lines[0], testing::HasSubstr(" WARN "));
+  EXPECT_EQ("Foo.cpp:12\twarning", stripHeader(lines[0]));
+  EXPECT_THAT(lines[1], testing::HasSubstr("LogTest.cpp:"));
+  EXPECT_THAT(lines[1], testing::EndsWith("\t(1, \"two\") = (1, two)"));
+  EXPECT_EQ("Bar.cpp:34\tcopied", stripHeader(lines[2]));
+}
+
+TEST_F(LogTest, logsRecordsWithoutObjects) {
+  LOGI();
+  Log::enableDeferredFormatting();
+  LOGI();
+  Log::flush();
+
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(2, lines.size());
+  EXPECT_THAT(lines[0], testing::EndsWith("\t"));
+  EXPECT_THAT(lines[1], testing::EndsWith("\t"));
+}
+
+TEST_F(LogTest, recordsCarryThreadAndSequenceNumber) {
+  const int THREADS = 4;
+  const int COUNT = 500;
+
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < THREADS; ++thread) {
+    threads.emplace_back([thread]() {
+      for (int i = 0; i < COUNT; ++i) {
+        LOGI(thread, ' ', i, ' ', string(100, 'x'));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(THREADS * COUNT, lines.size());
+  std::set<uint64_t> sequenceNumbers;
+  std::map<int, std::set<unsigned>> threadIds;
+  for (const string& line : lines) {
+    ASSERT_THAT(line, testing::MatchesRegex(
+        ".*  INFO [0-9]+ #[0-9]+ .*LogTest.cpp:[0-9]+\t"
+        "[0-9] [0-9]+ x{100}"));
+    sequenceNumbers.insert(getSequenceNumber(line));
+    int thread = std::stoi(line.substr(line.find('\t') + 1));
+    unsigned threadId;
+    std::istringstream(line.substr(line.find(" INFO ") + 6)) >> threadId;
+    threadIds[thread].insert(threadId);
+  }
+  EXPECT_EQ(THREADS * COUNT, sequenceNumbers.size());
+  ASSERT_EQ(THREADS, threadIds.size());
+  std::set<unsigned> distinctIds;
+  for (const auto& ids : threadIds) {
+    ASSERT_EQ(1, ids.second.size());
+    distinctIds.insert(*ids.second.begin());
+  }
+  EXPECT_EQ(THREADS, distinctIds.size());
+}
+
+struct Recursive {
+};
+
+static std::ostream& operator << (
+    std::ostream& outputStream,
+    const Recursive&) {
+  LOGI("inner");
+  return outputStream << "outer";
+}
+
+TEST_F(LogTest, recordsLoggedWhileFormattingStayIntact) {
+  Recursive recursive;
+  LOGI(std::hex, 255, ' ', recursive);
+  LOGI(255);
+
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(3, lines.size());
+  EXPECT_THAT(lines[0], testing::EndsWith("\tinner"));
+  EXPECT_THAT(lines[1], testing::EndsWith("\tff outer"));
+  EXPECT_THAT(lines[2], testing::EndsWith("\t255"));
+  EXPECT_LT(getSequenceNumber(lines[1]), getSequenceNumber(lines[0]));
+}
+
+TEST_F(LogTest, formatsTimestampWithRequestedPrecision) {
+  LOGI("seconds");
+  Log::setTimestampPrecision(Log::TimestampPrecision::MILLISECONDS);
+  LOGI("milliseconds");
+  Log::setTimestampPrecision(Log::TimestampPrecision::MICROSECONDS);
+  LOGI("microseconds");
+
+  const string DATE_TIME =
+      "^[0-9]{4}-[0-9]{2}-[0-9]{2} [0-9]{2}:[0-9]{2}:[0-9]{2}";
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(3, lines.size());
+  EXPECT_THAT(lines[0], testing::MatchesRegex(DATE_TIME + "  INFO .*"));
+  EXPECT_THAT(
+      lines[1],
+      testing::MatchesRegex(DATE_TIME + "\\.[0-9]{3}  INFO .*"));
+  EXPECT_THAT(
+      lines[2],
+      testing::MatchesRegex(DATE_TIME + "\\.[0-9]{6}  INFO .*"));
+}
+
+TEST_F(LogTest, timestampsNeverGoBackwards) {
+  const size_t TIMESTAMP_LENGTH = 26;
+  Log::setTimestampPrecision(Log::TimestampPrecision::MICROSECONDS);
+  for (int i = 0; i < 1000; ++i) {
+    LOGI(i);
+  }
+
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(1000, lines.size());
+  for (size_t i = 1; i < lines.size(); ++i) {
+    ASSERT_LE(
+        lines[i - 1].substr(0, TIMESTAMP_LENGTH),
+        lines[i].substr(0, TIMESTAMP_LENGTH));
+  }
+}
+
+TEST_F(LogTest, asyncWriterKeepsOrderOfEachThread) {
+  const int THREADS = 4;
+  const int COUNT = 500;
+  Log::enableAsync(64, Log::OverflowPolicy::BLOCK);
+
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < THREADS; ++thread) {
+    threads.emplace_back([thread]() {
+      for (int i = 0; i < COUNT; ++i) {
+        LOGI(thread, ' ', i);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  Log::flush();
+
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(THREADS * COUNT, lines.size());
+  std::vector<int> expected(THREADS, 0);
+  for (const string& line : lines) {
+    std::istringstream message(line.substr(line.find('\t') + 1));
+    int thread;
+    int i;
+    message >> thread >> i;
+    ASSERT_EQ(expected[thread], i);
+    ++expected[thread];
+  }
+  EXPECT_EQ(0, Log::getDroppedCount());
+}
+
+TEST_F(LogTest, disablingAsyncWritesQueuedRecords) {
+  Log::enableAsync();
+  for (int i = 0; i < 100; ++i) {
+    LOGI(i);
+  }
+  Log::disableAsync();
+
+  EXPECT_EQ(100, readLogFile().size());
+}
+
+TEST_F(LogTest, dropPolicyAccountsForEveryRecord) {
+  const int COUNT = 1000;
+  Log::enableAsync(4, Log::OverflowPolicy::DROP);
+  for (int i = 0; i < COUNT; ++i) {
+    LOGI(i);
+  }
+  Log::flush();
+  size_t dropped = Log::getDroppedCount();
+
+  EXPECT_EQ(COUNT, readLogFile().size() + dropped);
+}
+
+TEST_F(LogTest, deferredRecordsLookLikeImmediateOnes) {
+  Point point = {1, 2};
+
+  logSample("text");
+  Log::enableDeferredFormatting();
+  // Not supported by deferred formatting, so written right away.
+  LOGI(point);
+  logSample("text");
+  DEBUG(point.x, "two");
+  Log::flush();
+
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(4, lines.size());
+  EXPECT_THAT(lines[0], testing::EndsWith(
+      "\ttext -42 3.25 1099511627776 literal abc text"));
+  EXPECT_THAT(lines[1], testing::EndsWith("\t[1,2]"));
+  EXPECT_EQ(stripHeader(lines[0]), stripHeader(lines[2]));
+  EXPECT_THAT(lines[3], testing::EndsWith("\t(point.x, \"two\") = (1, two)"));
+}
+
+TEST_F(LogTest, deferredNullStringPrintsNothing) {
+  const char* null = nullptr;
+  Log::enableDeferredFormatting();
+  LOGI("a", null);
+  Log::flush();
+
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(1, lines.size());
+  EXPECT_THAT(lines[0], testing::EndsWith("\ta"));
+}
+
+TEST_F(LogTest, recordsTooLargeForStagingBufferAreWrittenImmediately) {
+  const size_t BUFFER_SIZE = 128;
+  Log::enableDeferredFormatting(BUFFER_SIZE);
+
+  // Covers the boundary at half of the buffer from every position.
+  for (size_t size = 0; size < BUFFER_SIZE; ++size) {
+    LOGI(string(size, 'x'));
+  }
+  Log::flush();
+
+  EXPECT_EQ(BUFFER_SIZE, readLogFile().size());
+}
+
+TEST_F(LogTest, deferredFormattingKeepsOrderOfEachThread) {
+  const int THREADS = 4;
+  const int COUNT = 2000;
+  Log::enableDeferredFormatting(1024);
+
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < THREADS; ++thread) {
+    threads.emplace_back([thread]() {
+      for (int i = 0; i < COUNT; ++i) {
+        LOGI(thread, ' ', i);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  Log::disableDeferredFormatting();
+
+  std::vector<string> lines = readLogFile();
+  ASSERT_EQ(THREADS * COUNT, lines.size());
+  std::vector<int> expected(THREADS, 0);
+  for (const string& line : lines) {
+    std::istringstream message(line.substr(line.find('\t') + 1));
+    int thread;
+    int i;
+    message >> thread >> i;
+    ASSERT_EQ(expected[thread], i);
+    ++expected[thread];
+  }
+}
@@ -0,0 +1,92 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "Core/MpscQueue.h"
+
+using MarathonKit::Core::MpscQueue;
+
+TEST(MpscQueueTest, roundsCapacityUpToPowerOfTwo) {
+  MpscQueue<int> queue(5);
+
+  EXPECT_EQ(8, queue.capacity());
+}
+
+TEST(MpscQueueTest, rejectsPushWhenFull) {
+  MpscQueue<int> queue(2);
+
+  EXPECT_TRUE(queue.isEmpty());
+  EXPECT_TRUE(queue.tryPush(1));
+  EXPECT_TRUE(queue.tryPush(2));
+  EXPECT_FALSE(queue.tryPush(3));
+  EXPECT_FALSE(queue.isEmpty());
+
+  int value = 0;
+  ASSERT_TRUE(queue.tryPop(value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(queue.tryPush(3));
+  ASSERT_TRUE(queue.tryPop(value));
+  EXPECT_EQ(2, value);
+  ASSERT_TRUE(queue.tryPop(value));
+  EXPECT_EQ(3, value);
+  EXPECT_FALSE(queue.tryPop(value));
+}
+
+TEST(MpscQueueTest, preservesOrderOfEachProducer) {
+  const int PRODUCERS = 4;
+  const int COUNT = 20000;
+  MpscQueue<int> queue(64);
+
+  std::vector<std::thread> producers;
+  for (int producer = 0; producer < PRODUCERS; ++producer) {
+    producers.emplace_back([&queue, producer]() {
+      for (int i = 0; i < COUNT; ++i) {
+        while (!queue.tryPush(producer * COUNT + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<int> expected(PRODUCERS, 0);
+  for (int received = 0; received < PRODUCERS * COUNT;) {
+    int value;
+    if (queue.tryPop(value)) {
+      int producer = value / COUNT;
+      EXPECT_EQ(expected[producer], value % COUNT);
+      expected[producer] = value % COUNT + 1;
+      ++received;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+
+  EXPECT_TRUE(queue.isEmpty());
+}
@@ -0,0 +1,307 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "Core/Network.h"
+#include "Core/Resolver.h"
+#include "Core/TcpAcceptorPool.h"
+#include "Core/TcpClient.h"
+
+using MarathonKit::Core::ListeningFileDescriptor;
+using MarathonKit::Core::MessageFileDescriptor;
+using MarathonKit::Core::Network;
+using MarathonKit::Core::Resolver;
+using MarathonKit::Core::SocketOptions;
+using MarathonKit::Core::StreamFileDescriptor;
+using MarathonKit::Core::TcpAcceptorPool;
+using MarathonKit::Core::TcpClient;
+using std::shared_ptr;
+using std::unique_ptr;
+
+static std::string getUniqueUnixPath(const std::string& name) {
+  return "@MarathonKitTest-" + name + "-" + std::to_string(getpid());
+}
+
+static Resolver::Address createLoopbackAddress(int family, uint16_t port) {
+  Resolver::Address address;
+  memset(&address, 0, sizeof address);
+  address.family = family;
+  address.socketType = SOCK_STREAM;
+  address.protocol = IPPROTO_TCP;
+  if (family == AF_INET) {
+    sockaddr_in* ipv4 = reinterpret_cast<sockaddr_in*>(&address.address);
+    ipv4->sin_family = AF_INET;
+    ipv4->sin_port = htons(port);
+    ipv4->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.addressLength = sizeof *ipv4;
+  } else {
+    sockaddr_in6* ipv6 = reinterpret_cast<sockaddr_in6*>(&address.address);
+    ipv6->sin6_family = AF_INET6;
+    ipv6->sin6_port = htons(port);
+    ipv6->sin6_addr = in6addr_loopback;
+    address.addressLength = sizeof *ipv6;
+  }
+  return address;
+}
+
+// Listens on the loopback address of a single family. With port 0 the system
+// chooses the port and it is stored back.
+static unique_ptr<ListeningFileDescriptor> listenOnLoopback(
+    int family,
+    uint16_t& port,
+    int backlog) {
+  int fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+  if (fd < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  unique_ptr<ListeningFileDescriptor> listener =
+      ListeningFileDescriptor::createOwnerOf(fd);
+  int on = 1;
+  if (family == AF_INET6 &&
+      setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof on) != 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  Resolver::Address address = createLoopbackAddress(family, port);
+  if (bind(fd, address.getSockaddr(), address.addressLength) != 0 ||
+      listen(fd, backlog) != 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  port = static_cast<uint16_t>(std::stoi(listener->getLocalService()));
+  return listener;
+}
+
+// Makes the host resolve to both loopback addresses in the given order.
+static void pinLoopbackHost(
+    const std::string& host,
+    uint16_t port,
+    int firstFamily,
+    int secondFamily) {
+  Resolver::Query query;
+  query.host = host;
+  query.service = std::to_string(port);
+  query.family = AF_UNSPEC;
+  query.socketType = SOCK_STREAM;
+  query.protocol = IPPROTO_TCP;
+  query.flags = 0;
+  Resolver::getInstance().pin(query, std::vector<Resolver::Address>{
+      createLoopbackAddress(firstFamily, port),
+      createLoopbackAddress(secondFamily, port)});
+}
+
+static int getPeerFamily(const StreamFileDescriptor& fd) {
+  sockaddr_storage address;
+  socklen_t addressLength = sizeof address;
+  if (getpeername(
+      fd.getNativeHandle(),
+      reinterpret_cast<sockaddr*>(&address),
+      &addressLength) != 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  return address.ss_family;
+}
+
+TEST(NetworkTest, acceptsTcpConnections) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0");
+  TcpClient client("localhost", listener->getLocalService());
+  TcpClient server(shared_ptr<StreamFileDescriptor>(listener->accept()));
+
+  client.sendLine("ping");
+  EXPECT_EQ("ping", server.getLine());
+  server.sendLine("pong");
+  EXPECT_EQ("pong", client.getLine());
+}
+
+TEST(NetworkTest, acceptStopsAtDeadline) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0");
+
+  EXPECT_FALSE(listener->isReadyForAccepting());
+  EXPECT_EQ(nullptr, listener->accept(std::chrono::steady_clock::now()));
+}
+
+TEST(NetworkTest, triesNextAddressRightAfterRefusal) {
+  uint16_t port = 0;
+  unique_ptr<ListeningFileDescriptor> listener =
+      listenOnLoopback(AF_INET, port, SOMAXCONN);
+  // Nothing listens on the IPv6 loopback, so the first attempt is refused.
+  pinLoopbackHost("refused-first.test", port, AF_INET6, AF_INET);
+
+  auto start = std::chrono::steady_clock::now();
+  unique_ptr<StreamFileDescriptor> fd = Network::createTcpConnection(
+      "refused-first.test",
+      std::to_string(port));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  ASSERT_NE(nullptr, fd);
+  EXPECT_EQ(AF_INET, getPeerFamily(*fd));
+  EXPECT_LT(elapsed, std::chrono::milliseconds(250));
+}
+
+TEST(NetworkTest, triesWinningFamilyFirstNextTime) {
+  // With a backlog of zero, the first connection fills the accept queue of
+  // the IPv4 listener and the handshakes of the following ones do not
+  // complete.
+  uint16_t port = 0;
+  unique_ptr<ListeningFileDescriptor> stalled =
+      listenOnLoopback(AF_INET, port, 0);
+  unique_ptr<ListeningFileDescriptor> listener =
+      listenOnLoopback(AF_INET6, port, SOMAXCONN);
+  unique_ptr<StreamFileDescriptor> first =
+      Network::createTcpConnection("127.0.0.1", std::to_string(port));
+  ASSERT_NE(nullptr, first);
+  pinLoopbackHost("stalled-first.test", port, AF_INET, AF_INET6);
+
+  // The IPv6 attempt starts when the IPv4 one is still pending after 250 ms.
+  auto start = std::chrono::steady_clock::now();
+  unique_ptr<StreamFileDescriptor> fd = Network::createTcpConnection(
+      "stalled-first.test",
+      std::to_string(port));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT_NE(nullptr, fd);
+  EXPECT_EQ(AF_INET6, getPeerFamily(*fd));
+  EXPECT_GE(elapsed, std::chrono::milliseconds(250));
+
+  // IPv6 won, so it is tried first and the stalled address is not waited for.
+  start = std::chrono::steady_clock::now();
+  fd = Network::createTcpConnection("stalled-first.test", std::to_string(port));
+  elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT_NE(nullptr, fd);
+  EXPECT_EQ(AF_INET6, getPeerFamily(*fd));
+  EXPECT_LT(elapsed, std::chrono::milliseconds(250));
+}
+
+TEST(NetworkTest, connectionStopsAtDeadline) {
+  // Unroutable addresses fail right away on machines without a network, but
+  // a full accept queue reliably stalls the handshake.
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0", 0);
+  unique_ptr<StreamFileDescriptor> first =
+      Network::createTcpConnection("127.0.0.1", listener->getLocalService());
+  ASSERT_NE(nullptr, first);
+
+  auto start = std::chrono::steady_clock::now();
+  unique_ptr<StreamFileDescriptor> fd = Network::createTcpConnection(
+      "127.0.0.1",
+      listener->getLocalService(),
+      SocketOptions(),
+      start + std::chrono::milliseconds(100));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_EQ(nullptr, fd);
+  EXPECT_GE(elapsed, std::chrono::milliseconds(100));
+  EXPECT_LT(elapsed, std::chrono::milliseconds(900));
+}
+
+TEST(NetworkTest, acceptorPoolHandlesAllConnections) {
+  const int CONNECTION_COUNT = 32;
+  std::atomic<int> handled(0);
+  TcpAcceptorPool pool(
+      "0",
+      4,
+      [&handled](unique_ptr<StreamFileDescriptor> fd) {
+        TcpClient server{shared_ptr<StreamFileDescriptor>(std::move(fd))};
+        server.sendLine(server.getLine());
+        ++handled;
+      });
+
+  for (int i = 0; i < CONNECTION_COUNT; ++i) {
+    TcpClient client("localhost", pool.getLocalService());
+    client.sendLine(std::to_string(i));
+    EXPECT_EQ(std::to_string(i), client.getLine());
+  }
+  pool.stop();
+
+  EXPECT_EQ(CONNECTION_COUNT, handled);
+}
+
+TEST(NetworkTest, connectsOverUnixStreamSockets) {
+  std::string path = getUniqueUnixPath("stream");
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createUnixListener(path);
+  TcpClient client{shared_ptr<StreamFileDescriptor>(
+      Network::createUnixConnection(path))};
+  TcpClient server(shared_ptr<StreamFileDescriptor>(listener->accept()));
+
+  client.sendLine("ping");
+  EXPECT_EQ("ping", server.getLine());
+  server.sendLine("pong");
+  EXPECT_EQ("pong", client.getLine());
+}
+
+TEST(NetworkTest, unixAcceptStopsAtDeadline) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createUnixListener(getUniqueUnixPath("deadline"));
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(
+      nullptr,
+      listener->accept(start + std::chrono::milliseconds(50)));
+  EXPECT_GE(
+      std::chrono::steady_clock::now() - start,
+      std::chrono::milliseconds(50));
+}
+
+TEST(NetworkTest, replacesOnlyStaleUnixSocketFiles) {
+  std::string path = "/tmp/MarathonKitTest-socket-" + std::to_string(getpid());
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createUnixListener(path);
+
+  EXPECT_THROW(Network::createUnixListener(path), std::runtime_error);
+
+  // The socket file stays behind after the listener is closed.
+  listener.reset();
+  listener = Network::createUnixListener(path);
+  EXPECT_NE(nullptr, listener);
+  unlink(path.c_str());
+}
+
+TEST(NetworkTest, sendsUnixDatagrams) {
+  std::string path = getUniqueUnixPath("datagram");
+  unique_ptr<MessageFileDescriptor> listener =
+      Network::createUnixDatagramListener(path);
+  unique_ptr<MessageFileDescriptor> client =
+      Network::createUnixDatagramConnection(path);
+
+  client->write("first");
+  client->write("second");
+  EXPECT_EQ("first", listener->read());
+  EXPECT_EQ("second", listener->read());
+}
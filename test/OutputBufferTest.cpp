@@ -0,0 +1,97 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <clocale>
+#include <climits>
+#include <limits>
+#include <string>
+
+#include <gmock/gmock.h>
+
+#include "Core/OutputBuffer.h"
+
+using MarathonKit::Core::OutputBuffer;
+using std::string;
+
+TEST(OutputBufferTest, formatsIntegers) {
+  OutputBuffer buffer;
+  buffer.append(0);
+  buffer.append(' ');
+  buffer.append(-7);
+  buffer.append(' ');
+  buffer.append(1234567890123LL);
+  buffer.append(' ');
+  buffer.append(LLONG_MIN);
+  buffer.append(' ');
+  buffer.append(ULLONG_MAX);
+
+  EXPECT_EQ(
+      "0 -7 1234567890123 -9223372036854775808 18446744073709551615",
+      buffer.getData());
+}
+
+TEST(OutputBufferTest, formatsShortestFloatingPoint) {
+  OutputBuffer buffer;
+  buffer.append(0.1);
+  buffer.append(' ');
+  buffer.append(-2.5f);
+  buffer.append(' ');
+  buffer.append(0.1f);
+  buffer.append(' ');
+  buffer.append(1.0 / 3);
+
+  EXPECT_EQ("0.1 -2.5 0.1 0.3333333333333333", buffer.getData());
+}
+
+TEST(OutputBufferTest, formatsFloatingPointThatNeedsMoreDigits) {
+  OutputBuffer buffer;
+  buffer.append(1.0f / 3);
+  buffer.append(' ');
+  buffer.append(16777216.0f);
+  buffer.append(' ');
+  buffer.append(0.1 + 0.2);
+
+  EXPECT_EQ("0.33333334 16777216 0.30000000000000004", buffer.getData());
+}
+
+TEST(OutputBufferTest, ignoresLocale) {
+  string previous = std::setlocale(LC_NUMERIC, nullptr);
+  if (std::setlocale(LC_NUMERIC, "de_DE.UTF-8") == nullptr) {
+    return;
+  }
+  OutputBuffer buffer;
+  buffer.append(1.5);
+  std::setlocale(LC_NUMERIC, previous.c_str());
+
+  EXPECT_EQ("1.5", buffer.getData());
+}
+
+TEST(OutputBufferTest, clearKeepsCapacity) {
+  OutputBuffer buffer;
+  buffer.append(string(100, 'x'));
+  size_t capacity = buffer.getData().capacity();
+  buffer.clear();
+
+  EXPECT_TRUE(buffer.isEmpty());
+  EXPECT_EQ(capacity, buffer.getData().capacity());
+}
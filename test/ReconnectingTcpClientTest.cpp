@@ -0,0 +1,139 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <gmock/gmock.h>
+
+#include "Core/Network.h"
+#include "Core/ReconnectingTcpClient.h"
+#include "Core/TcpClient.h"
+
+using MarathonKit::Core::FileDescriptor;
+using MarathonKit::Core::ListeningFileDescriptor;
+using MarathonKit::Core::Network;
+using MarathonKit::Core::ReconnectingTcpClient;
+using MarathonKit::Core::StreamFileDescriptor;
+using MarathonKit::Core::TcpClient;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+
+TEST(ReconnectingTcpClientTest, replaysUnansweredCommandsAfterReconnect) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0");
+  ReconnectingTcpClient client("localhost", listener->getLocalService());
+  client.setHandshake([](TcpClient& connection) {
+    connection.sendLine("LOGIN");
+  });
+
+  std::thread server([&listener]() {
+    {
+      // The first connection drops before the command is answered.
+      TcpClient connection(
+          shared_ptr<StreamFileDescriptor>(listener->accept()));
+      EXPECT_EQ("LOGIN", connection.getLine());
+      EXPECT_EQ("MOVE 1", connection.getLine());
+    }
+    TcpClient connection(shared_ptr<StreamFileDescriptor>(listener->accept()));
+    EXPECT_EQ("LOGIN", connection.getLine());
+    EXPECT_EQ("MOVE 1", connection.getLine());
+    connection.sendLine("OK 1");
+  });
+
+  client.sendLine("MOVE 1");
+  EXPECT_EQ(1, client.getUnansweredCount());
+  EXPECT_EQ("OK 1", client.getLine());
+  server.join();
+
+  EXPECT_EQ(0, client.getUnansweredCount());
+  EXPECT_EQ(2, client.getConnectionCount());
+}
+
+TEST(ReconnectingTcpClientTest, sendLineDoesNotSleepThroughBackoff) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0");
+  ReconnectingTcpClient client("localhost", listener->getLocalService());
+  client.setBackoff(
+      std::chrono::milliseconds(200),
+      std::chrono::milliseconds(200));
+  int handshakes = 0;
+  client.setHandshake([&handshakes](TcpClient&) {
+    if (++handshakes == 1) {
+      throw std::runtime_error("Rejected");
+    }
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  client.sendLine("MOVE 1");
+  client.sendLine("MOVE 2");
+  EXPECT_LT(
+      std::chrono::steady_clock::now() - start,
+      std::chrono::milliseconds(100));
+  EXPECT_EQ(1, handshakes);
+  EXPECT_FALSE(client.isConnected());
+  EXPECT_EQ(-1, client.getNativeHandle());
+  EXPECT_EQ(2, client.getUnansweredCount());
+  EXPECT_GE(client.getNextAttempt(), start + std::chrono::milliseconds(200));
+
+  // Once the attempt is due, linesReady reconnects and replays both commands.
+  std::this_thread::sleep_until(client.getNextAttempt());
+  EXPECT_EQ(0, client.linesReady());
+  EXPECT_TRUE(client.isConnected());
+  EXPECT_NE(-1, client.getNativeHandle());
+  EXPECT_EQ(FileDescriptor::Deadline::max(), client.getNextAttempt());
+
+  // The first connection was the rejected one.
+  listener->accept();
+  TcpClient server(shared_ptr<StreamFileDescriptor>(listener->accept()));
+  EXPECT_EQ("MOVE 1", server.getLine());
+  EXPECT_EQ("MOVE 2", server.getLine());
+  EXPECT_EQ(1, client.getConnectionCount());
+}
+
+TEST(ReconnectingTcpClientTest, givesUpAfterMaxAttempts) {
+  string service = Network::createTcpListener("0")->getLocalService();
+  ReconnectingTcpClient client("localhost", service);
+  client.setBackoff(
+      std::chrono::milliseconds(1),
+      std::chrono::milliseconds(2));
+  client.setMaxAttempts(3);
+
+  EXPECT_THROW(client.connect(), std::runtime_error);
+  EXPECT_FALSE(client.isConnected());
+}
+
+TEST(ReconnectingTcpClientTest, limitsUnansweredCommands) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0");
+  ReconnectingTcpClient client("localhost", listener->getLocalService());
+  client.setReplayLimit(1);
+
+  client.sendLine("A");
+  EXPECT_THROW(client.sendLine("B"), std::runtime_error);
+  EXPECT_EQ(1, client.getUnansweredCount());
+}
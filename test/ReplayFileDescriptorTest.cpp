@@ -0,0 +1,161 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <gmock/gmock.h>
+
+#include "Core/LineBuffer.h"
+#include "Core/RecordingFileDescriptor.h"
+#include "Core/ReplayFileDescriptor.h"
+#include "Core/StreamFileDescriptor.h"
+#include "Core/TcpClient.h"
+
+#include "ConnectedPair.h"
+
+using MarathonKit::Core::LineBuffer;
+using MarathonKit::Core::RecordingFileDescriptor;
+using MarathonKit::Core::ReplayFileDescriptor;
+using MarathonKit::Core::StreamFileDescriptor;
+using MarathonKit::Core::TcpClient;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+
+class ReplayFileDescriptorTest : public testing::Test {
+protected:
+
+  ReplayFileDescriptorTest():
+    mPath("/tmp/MarathonKitTest-session-" + std::to_string(getpid())) {}
+
+  virtual void TearDown() {
+    unlink(mPath.c_str());
+  }
+
+  // Records a session in which the server sends two lines in three chunks.
+  void recordSession(std::chrono::milliseconds pause) {
+    StreamPair pair;
+    unique_ptr<StreamFileDescriptor> server = std::move(pair.second);
+    TcpClient client(std::make_shared<RecordingFileDescriptor>(
+        shared_ptr<StreamFileDescriptor>(std::move(pair.first)),
+        mPath));
+
+    server->write("first\nsec");
+    EXPECT_EQ("first", client.getLine());
+    client.sendLine("reply");
+    std::this_thread::sleep_for(pause);
+    server->write("ond");
+    EXPECT_EQ(0, client.linesReady());
+    server->write("\n");
+    EXPECT_EQ("second", client.getLine());
+  }
+
+  const string mPath;
+
+};
+
+TEST_F(ReplayFileDescriptorTest, replaysReceivedChunks) {
+  recordSession(std::chrono::milliseconds(0));
+  shared_ptr<ReplayFileDescriptor> replay =
+      ReplayFileDescriptor::createFromFile(
+          mPath,
+          ReplayFileDescriptor::Pacing::AS_FAST_AS_POSSIBLE);
+
+  EXPECT_EQ("first\nsec", replay->read());
+  EXPECT_EQ("ond", replay->read());
+  EXPECT_EQ("\n", replay->read());
+  EXPECT_TRUE(replay->isReadyForReading());
+  EXPECT_EQ("", replay->read());
+}
+
+TEST_F(ReplayFileDescriptorTest, feedsLineBuffer) {
+  recordSession(std::chrono::milliseconds(0));
+  LineBuffer buffer(shared_ptr<ReplayFileDescriptor>(
+      ReplayFileDescriptor::createFromFile(
+          mPath,
+          ReplayFileDescriptor::Pacing::AS_FAST_AS_POSSIBLE)));
+
+  EXPECT_EQ("first", buffer.getLine());
+  EXPECT_EQ("second", buffer.getLine());
+  EXPECT_THROW(buffer.getLine(), std::runtime_error);
+}
+
+TEST_F(ReplayFileDescriptorTest, keepsRecordedPacing) {
+  recordSession(std::chrono::milliseconds(50));
+  unique_ptr<ReplayFileDescriptor> replay =
+      ReplayFileDescriptor::createFromFile(
+          mPath,
+          ReplayFileDescriptor::Pacing::REAL_TIME);
+  auto start = std::chrono::steady_clock::now();
+
+  EXPECT_EQ("first\nsec", replay->read());
+  EXPECT_FALSE(replay->isReadyForReading());
+  EXPECT_FALSE(replay->waitForReading(start + std::chrono::milliseconds(10)));
+  EXPECT_EQ("ond", replay->read());
+  EXPECT_GE(
+      std::chrono::steady_clock::now() - start,
+      std::chrono::milliseconds(50));
+}
+
+TEST_F(ReplayFileDescriptorTest, recordingFailureDoesNotLoseData) {
+  // The log goes to a pipe whose reading end is closed after the header.
+  int logFds[2];
+  ASSERT_EQ(0, pipe(logFds));
+  StreamPair pair;
+  RecordingFileDescriptor recorder(
+      shared_ptr<StreamFileDescriptor>(std::move(pair.first)),
+      "/proc/self/fd/" + std::to_string(logFds[1]));
+  close(logFds[0]);
+  close(logFds[1]);
+  void (*previousHandler)(int) = signal(SIGPIPE, SIG_IGN);
+
+  pair.second->write("received");
+  EXPECT_EQ("received", recorder.read());
+  EXPECT_NO_THROW(recorder.write("sent"));
+  EXPECT_EQ("sent", pair.second->read());
+
+  signal(SIGPIPE, previousHandler);
+}
+
+TEST_F(ReplayFileDescriptorTest, rejectsOtherFiles) {
+  {
+    std::FILE* file = std::fopen(mPath.c_str(), "w");
+    std::fputs("This is not a session log", file);
+    std::fclose(file);
+  }
+
+  EXPECT_THROW(
+      ReplayFileDescriptor::createFromFile(
+          mPath,
+          ReplayFileDescriptor::Pacing::REAL_TIME),
+      std::runtime_error);
+}
@@ -0,0 +1,157 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <netdb.h>
+#include <netinet/in.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "Core/Resolver.h"
+
+using MarathonKit::Core::Resolver;
+using std::vector;
+
+static Resolver::Query createQuery(const std::string& host) {
+  Resolver::Query query;
+  query.host = host;
+  query.service = "1234";
+  query.family = AF_UNSPEC;
+  query.socketType = SOCK_STREAM;
+  query.protocol = IPPROTO_TCP;
+  query.flags = 0;
+  return query;
+}
+
+class CountingLookup {
+public:
+
+  CountingLookup(int error = 0):
+    mCalls(std::make_shared<std::atomic<int>>(0)),
+    mError(error) {}
+
+  int operator () (
+      const Resolver::Query&,
+      vector<Resolver::Address>& addresses) const {
+    ++*mCalls;
+    if (mError != 0) {
+      return mError;
+    }
+    Resolver::Address address;
+    memset(&address, 0, sizeof address);
+    address.family = AF_INET;
+    addresses.push_back(address);
+    return 0;
+  }
+
+  int getCalls() const { return *mCalls; }
+
+private:
+
+  std::shared_ptr<std::atomic<int>> mCalls;
+  int mError;
+
+};
+
+TEST(ResolverTest, cachesSuccessfulLookups) {
+  CountingLookup lookup;
+  Resolver resolver(lookup);
+
+  EXPECT_EQ(1, resolver.resolve(createQuery("a")).size());
+  EXPECT_EQ(1, resolver.resolve(createQuery("a")).size());
+  EXPECT_EQ(1, lookup.getCalls());
+
+  resolver.resolve(createQuery("b"));
+  EXPECT_EQ(2, lookup.getCalls());
+}
+
+TEST(ResolverTest, cachesFailedLookups) {
+  CountingLookup lookup(EAI_NONAME);
+  Resolver resolver(lookup);
+
+  EXPECT_THROW(resolver.resolve(createQuery("a")), std::runtime_error);
+  EXPECT_THROW(resolver.resolve(createQuery("a")), std::runtime_error);
+  EXPECT_EQ(1, lookup.getCalls());
+}
+
+TEST(ResolverTest, doesNotCacheTemporaryFailures) {
+  CountingLookup lookup(EAI_AGAIN);
+  Resolver resolver(lookup);
+
+  EXPECT_THROW(resolver.resolve(createQuery("a")), std::runtime_error);
+  EXPECT_THROW(resolver.resolve(createQuery("a")), std::runtime_error);
+  EXPECT_EQ(2, lookup.getCalls());
+}
+
+TEST(ResolverTest, refreshesExpiredEntriesInBackground) {
+  CountingLookup lookup;
+  Resolver resolver(lookup);
+  resolver.setPositiveTimeToLive(std::chrono::milliseconds(0));
+
+  resolver.resolve(createQuery("a"));
+  EXPECT_EQ(1, resolver.resolve(createQuery("a")).size());
+
+  for (int i = 0; i < 1000 && lookup.getCalls() < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(2, lookup.getCalls());
+}
+
+TEST(ResolverTest, prefetchFillsTheCache) {
+  CountingLookup lookup;
+  Resolver resolver(lookup);
+
+  resolver.prefetch(createQuery("a"));
+  EXPECT_EQ(1, resolver.resolve(createQuery("a")).size());
+  EXPECT_EQ(1, lookup.getCalls());
+}
+
+TEST(ResolverTest, pinnedEntriesSkipLookupAndDoNotExpire) {
+  CountingLookup lookup;
+  Resolver resolver(lookup);
+  resolver.setPositiveTimeToLive(std::chrono::milliseconds(0));
+  Resolver::Address address;
+  memset(&address, 0, sizeof address);
+  address.family = AF_INET6;
+
+  resolver.pin(createQuery("a"), vector<Resolver::Address>(2, address));
+  EXPECT_EQ(2, resolver.resolve(createQuery("a")).size());
+  EXPECT_EQ(2, resolver.resolve(createQuery("a")).size());
+  EXPECT_EQ(0, lookup.getCalls());
+
+  resolver.clear();
+  EXPECT_EQ(1, resolver.resolve(createQuery("a")).size());
+  EXPECT_EQ(1, lookup.getCalls());
+}
+
+TEST(ResolverTest, resolvesLocalhostWithoutNetwork) {
+  Resolver resolver;
+
+  EXPECT_FALSE(resolver.resolve(createQuery("localhost")).empty());
+}
@@ -0,0 +1,106 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <gmock/gmock.h>
+
+#include "Core/SendScheduler.h"
+#include "Core/StreamFileDescriptor.h"
+#include "Core/TcpClient.h"
+
+#include "ConnectedPair.h"
+
+using MarathonKit::Core::SendScheduler;
+using MarathonKit::Core::StreamFileDescriptor;
+using MarathonKit::Core::TcpClient;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+
+class SendSchedulerTest : public testing::Test {
+protected:
+
+  SendSchedulerTest():
+    mClient(),
+    mServer() {}
+
+  virtual void SetUp() {
+    StreamPair pair;
+    mClient = TcpClient(shared_ptr<StreamFileDescriptor>(
+        std::move(pair.first)));
+    mServer = std::move(pair.second);
+  }
+
+  TcpClient mClient;
+  unique_ptr<StreamFileDescriptor> mServer;
+
+};
+
+TEST_F(SendSchedulerTest, queuesCommandsOverTheRate) {
+  SendScheduler scheduler(mClient, 100.0, 2);
+  auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < 6; ++i) {
+    scheduler.sendLine(std::to_string(i));
+  }
+  EXPECT_EQ(4, scheduler.getQueuedCount());
+  EXPECT_EQ("0\n1\n", mServer->read());
+
+  ASSERT_TRUE(scheduler.waitForAll());
+  // Four more commands at 100 per second.
+  EXPECT_GE(
+      std::chrono::steady_clock::now() - start,
+      std::chrono::milliseconds(40));
+  TcpClient server(shared_ptr<StreamFileDescriptor>(std::move(mServer)));
+  for (int i = 2; i < 6; ++i) {
+    EXPECT_EQ(std::to_string(i), server.getLine());
+  }
+}
+
+TEST_F(SendSchedulerTest, coalescesCommandsReleasedTogether) {
+  SendScheduler scheduler(mClient, 100.0, 3);
+  for (int i = 0; i < 6; ++i) {
+    scheduler.sendLine(std::to_string(i));
+  }
+  EXPECT_EQ("0\n1\n2\n", mServer->read());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  EXPECT_EQ(3, scheduler.releaseDue());
+  EXPECT_EQ("3\n4\n5\n", mServer->read());
+}
+
+TEST_F(SendSchedulerTest, stopsAtDeadline) {
+  SendScheduler scheduler(mClient, 1.0);
+  scheduler.sendLine("a");
+  scheduler.sendLine("b");
+
+  EXPECT_FALSE(scheduler.waitForAll(std::chrono::steady_clock::now()));
+  EXPECT_EQ(0, scheduler.releaseDue());
+  EXPECT_EQ(1, scheduler.getQueuedCount());
+}
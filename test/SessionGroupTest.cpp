@@ -0,0 +1,112 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "Core/SessionGroup.h"
+#include "Core/StreamFileDescriptor.h"
+#include "Core/TcpClient.h"
+
+#include "ConnectedPair.h"
+
+using MarathonKit::Core::SessionGroup;
+using MarathonKit::Core::StreamFileDescriptor;
+using MarathonKit::Core::TcpClient;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using testing::ElementsAre;
+
+class SessionGroupTest : public testing::Test {
+protected:
+
+  SessionGroupTest():
+    mGroup(),
+    mServers() {}
+
+  virtual void SetUp() {
+    for (int i = 0; i < 3; ++i) {
+      StreamPair pair;
+      mGroup.add(TcpClient(shared_ptr<StreamFileDescriptor>(
+          std::move(pair.first))));
+      mServers.push_back(std::move(pair.second));
+    }
+  }
+
+  SessionGroup mGroup;
+  vector<unique_ptr<StreamFileDescriptor>> mServers;
+
+};
+
+TEST_F(SessionGroupTest, reportsSessionsWithCompleteLines) {
+  mServers[0]->write("a\nb\n");
+  mServers[1]->write("partial");
+  mServers[2]->write("c\n");
+
+  EXPECT_THAT(mGroup.waitForLines(), ElementsAre(0, 2));
+  EXPECT_EQ("a", mGroup.get(0).getLine());
+  EXPECT_EQ("c", mGroup.get(2).getLine());
+
+  // The second line of session 0 is already buffered.
+  EXPECT_THAT(mGroup.waitForLines(), ElementsAre(0));
+  EXPECT_EQ("b", mGroup.get(0).getLine());
+}
+
+TEST_F(SessionGroupTest, stopsAtDeadline) {
+  mServers[1]->write("partial");
+
+  auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(20);
+  EXPECT_TRUE(mGroup.waitForLines(deadline).empty());
+  EXPECT_GE(std::chrono::steady_clock::now(), deadline);
+}
+
+TEST_F(SessionGroupTest, broadcastsToAllSessions) {
+  mGroup.broadcastLine("hello");
+
+  for (auto& server : mServers) {
+    EXPECT_EQ("hello\n", server->read());
+  }
+}
+
+TEST_F(SessionGroupTest, reportsClosedSessionOnce) {
+  mServers[1]->write("last\n");
+  mServers[1].reset();
+
+  EXPECT_THAT(mGroup.waitForLines(), ElementsAre(1));
+  EXPECT_EQ("last", mGroup.get(1).getLine());
+  EXPECT_THAT(mGroup.waitForLines(), ElementsAre(1));
+  EXPECT_TRUE(mGroup.isClosed(1));
+  EXPECT_THROW(mGroup.get(1).getLine(), std::runtime_error);
+
+  mServers[0]->write("x\n");
+  EXPECT_THAT(mGroup.waitForLines(), ElementsAre(0));
+}
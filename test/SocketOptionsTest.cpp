@@ -0,0 +1,94 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <memory>
+
+#include <gmock/gmock.h>
+
+#include "Core/Network.h"
+#include "Core/SocketOptions.h"
+
+using MarathonKit::Core::ListeningFileDescriptor;
+using MarathonKit::Core::Network;
+using MarathonKit::Core::SocketOptions;
+using MarathonKit::Core::StreamFileDescriptor;
+using std::unique_ptr;
+
+static unique_ptr<StreamFileDescriptor> connect(
+    const ListeningFileDescriptor& listener,
+    const SocketOptions& options) {
+  return Network::createTcpConnection(
+      "127.0.0.1",
+      listener.getLocalService(),
+      options);
+}
+
+static int getSocketOption(
+    const StreamFileDescriptor& fd,
+    int level,
+    int name) {
+  int value = 0;
+  socklen_t size = sizeof value;
+  EXPECT_EQ(0, getsockopt(fd.getNativeHandle(), level, name, &value, &size));
+  return value;
+}
+
+TEST(SocketOptionsTest, appliesLowLatencyPreset) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0");
+  unique_ptr<StreamFileDescriptor> fd =
+      connect(*listener, SocketOptions::lowLatency());
+
+  EXPECT_NE(0, getSocketOption(*fd, IPPROTO_TCP, TCP_NODELAY));
+  EXPECT_EQ(IPTOS_LOWDELAY, getSocketOption(*fd, IPPROTO_IP, IP_TOS));
+  EXPECT_NE(0, getSocketOption(*fd, SOL_SOCKET, SO_KEEPALIVE));
+  EXPECT_EQ(10, getSocketOption(*fd, IPPROTO_TCP, TCP_KEEPIDLE));
+  EXPECT_EQ(2, getSocketOption(*fd, IPPROTO_TCP, TCP_KEEPINTVL));
+  EXPECT_EQ(3, getSocketOption(*fd, IPPROTO_TCP, TCP_KEEPCNT));
+  EXPECT_EQ(0, getSocketOption(*fd, SOL_SOCKET, SO_BUSY_POLL));
+}
+
+TEST(SocketOptionsTest, appliesBulkThroughputPreset) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0");
+  unique_ptr<StreamFileDescriptor> plain = connect(*listener, SocketOptions());
+  unique_ptr<StreamFileDescriptor> fd =
+      connect(*listener, SocketOptions::bulkThroughput());
+
+  // The kernel caps the requested sizes, but they still exceed the defaults.
+  EXPECT_GT(
+      getSocketOption(*fd, SOL_SOCKET, SO_RCVBUF),
+      getSocketOption(*plain, SOL_SOCKET, SO_RCVBUF));
+  EXPECT_GT(
+      getSocketOption(*fd, SOL_SOCKET, SO_SNDBUF),
+      getSocketOption(*plain, SOL_SOCKET, SO_SNDBUF));
+  EXPECT_EQ(IPTOS_THROUGHPUT, getSocketOption(*fd, IPPROTO_IP, IP_TOS));
+  EXPECT_NE(0, getSocketOption(*fd, SOL_SOCKET, SO_KEEPALIVE));
+  EXPECT_EQ(60, getSocketOption(*fd, IPPROTO_TCP, TCP_KEEPIDLE));
+  EXPECT_EQ(0, getSocketOption(*plain, SOL_SOCKET, SO_KEEPALIVE));
+}
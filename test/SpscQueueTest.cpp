@@ -0,0 +1,87 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <thread>
+
+#include <gmock/gmock.h>
+
+#include "Core/SpscQueue.h"
+
+using MarathonKit::Core::SpscQueue;
+
+TEST(SpscQueueTest, roundsCapacityUpToPowerOfTwo) {
+  SpscQueue<int> queue(5);
+
+  EXPECT_EQ(8, queue.capacity());
+}
+
+TEST(SpscQueueTest, rejectsPushWhenFull) {
+  SpscQueue<int> queue(2);
+
+  EXPECT_TRUE(queue.tryPush(1));
+  EXPECT_TRUE(queue.tryPush(2));
+  EXPECT_FALSE(queue.tryPush(3));
+  EXPECT_EQ(2, queue.size());
+
+  int value = 0;
+  ASSERT_TRUE(queue.tryPop(value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(queue.tryPush(3));
+}
+
+TEST(SpscQueueTest, peekDoesNotRemove) {
+  SpscQueue<int> queue(2);
+
+  EXPECT_EQ(nullptr, queue.peek());
+  queue.tryPush(42);
+  ASSERT_NE(nullptr, queue.peek());
+  EXPECT_EQ(42, *queue.peek());
+  EXPECT_EQ(1, queue.size());
+}
+
+TEST(SpscQueueTest, preservesOrderBetweenThreads) {
+  const int COUNT = 100000;
+  SpscQueue<int> queue(64);
+
+  std::thread producer([&queue]() {
+    for (int i = 0; i < COUNT; ++i) {
+      while (!queue.tryPush(int(i))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  int expected = 0;
+  while (expected < COUNT) {
+    int value;
+    if (queue.tryPop(value)) {
+      EXPECT_EQ(expected, value);
+      ++expected;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  EXPECT_EQ(0, queue.size());
+}
@@ -0,0 +1,137 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <gmock/gmock.h>
+
+#include "Core/StagingBuffer.h"
+
+using MarathonKit::Core::StagingBuffer;
+using std::string;
+
+static void push(StagingBuffer& buffer, const string& data) {
+  char* output = buffer.reserve(data.size());
+  ASSERT_NE(nullptr, output);
+  std::memcpy(output, data.data(), data.size());
+  buffer.commit(data.size());
+}
+
+static string pop(StagingBuffer& buffer) {
+  size_t size;
+  const char* data = buffer.peek(size);
+  string result(data, size);
+  buffer.consume(size);
+  return result;
+}
+
+TEST(StagingBufferTest, returnsCommittedBytesOnly) {
+  StagingBuffer buffer(16);
+
+  EXPECT_EQ("", pop(buffer));
+  push(buffer, "abc");
+  char* output = buffer.reserve(2);
+  ASSERT_NE(nullptr, output);
+  std::memcpy(output, "de", 2);
+
+  EXPECT_EQ("abc", pop(buffer));
+  buffer.commit(2);
+  EXPECT_EQ("de", pop(buffer));
+}
+
+TEST(StagingBufferTest, wrapsAroundWhenTheEndIsTooClose) {
+  StagingBuffer buffer(10);
+
+  push(buffer, "abcdef");
+  EXPECT_EQ(nullptr, buffer.reserve(4));
+  EXPECT_EQ("abcdef", pop(buffer));
+
+  push(buffer, "ghij");
+  EXPECT_EQ("ghij", pop(buffer));
+  push(buffer, "kl");
+  EXPECT_EQ("kl", pop(buffer));
+}
+
+TEST(StagingBufferTest, doesNotOverwriteUnconsumedBytes) {
+  StagingBuffer buffer(10);
+
+  push(buffer, "abcdefgh");
+  size_t size;
+  buffer.peek(size);
+  buffer.consume(2);
+  // Wrapping would need more than the two consumed bytes.
+  EXPECT_EQ(nullptr, buffer.reserve(2));
+  push(buffer, "i");
+  EXPECT_EQ("cdefghi", pop(buffer));
+}
+
+TEST(StagingBufferTest, emptyBufferTakesAnythingBelowHalfCapacity) {
+  StagingBuffer buffer(8);
+
+  // With both positions in the middle, neither the end nor the wrapped space
+  // can take half of the buffer.
+  push(buffer, "abcd");
+  EXPECT_EQ("abcd", pop(buffer));
+  EXPECT_EQ(nullptr, buffer.reserve(4));
+
+  for (int position = 0; position < 8; ++position) {
+    EXPECT_NE(nullptr, buffer.reserve(3));
+    push(buffer, "x");
+    EXPECT_EQ("x", pop(buffer));
+  }
+}
+
+TEST(StagingBufferTest, preservesRecordsBetweenThreads) {
+  const int COUNT = 20000;
+  StagingBuffer buffer(256);
+
+  std::thread producer([&buffer]() {
+    for (int i = 0; i < COUNT; ++i) {
+      string record = std::to_string(i) + ';';
+      char* output;
+      while ((output = buffer.reserve(record.size())) == nullptr) {
+        std::this_thread::yield();
+      }
+      std::memcpy(output, record.data(), record.size());
+      buffer.commit(record.size());
+    }
+  });
+
+  string expected;
+  for (int i = 0; i < COUNT; ++i) {
+    expected += std::to_string(i) + ';';
+  }
+  string received;
+  while (received.size() < expected.size()) {
+    string data = pop(buffer);
+    if (data.empty()) {
+      std::this_thread::yield();
+    }
+    received += data;
+  }
+  producer.join();
+
+  EXPECT_EQ(expected, received);
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <gmock/gmock.h>
+
+#include "Core/Network.h"
+#include "Core/TcpClient.h"
+#include "Core/TcpClientPool.h"
+
+using MarathonKit::Core::FileDescriptor;
+using MarathonKit::Core::ListeningFileDescriptor;
+using MarathonKit::Core::Network;
+using MarathonKit::Core::StreamFileDescriptor;
+using MarathonKit::Core::TcpClient;
+using MarathonKit::Core::TcpClientPool;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+
+TEST(TcpClientPoolTest, handsOutPreparedClients) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0");
+  TcpClientPool pool("localhost", listener->getLocalService());
+  pool.setHandshake([](TcpClient& client) {
+    client.sendLine("HELLO");
+  });
+
+  pool.warmUp(3);
+  for (int i = 0; i < 3; ++i) {
+    TcpClient server(shared_ptr<StreamFileDescriptor>(listener->accept()));
+    EXPECT_EQ("HELLO", server.getLine());
+  }
+  for (int i = 0; i < 3; ++i) {
+    TcpClient client = pool.acquire();
+    EXPECT_TRUE(client.isConnected());
+  }
+
+  EXPECT_EQ(0, pool.getReadyCount());
+  EXPECT_THROW(pool.acquire(), std::runtime_error);
+}
+
+TEST(TcpClientPoolTest, countsFailedConnections) {
+  string service = Network::createTcpListener("0")->getLocalService();
+  TcpClientPool pool("localhost", service);
+
+  pool.warmUp(2);
+  TcpClient client;
+
+  EXPECT_FALSE(pool.acquire(client, std::chrono::steady_clock::now() +
+      std::chrono::seconds(5)));
+  EXPECT_EQ(2, pool.getFailedCount());
+  EXPECT_EQ(0, pool.getConnectingCount());
+}
+
+TEST(TcpClientPoolTest, countsAnyHandshakeExceptionAsFailure) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0");
+  TcpClientPool pool("localhost", listener->getLocalService());
+  pool.setHandshake([](TcpClient&) {
+    throw 42;
+  });
+
+  for (int round = 0; round < 3; ++round) {
+    pool.warmUp(2);
+    TcpClient client;
+    EXPECT_FALSE(pool.acquire(client, FileDescriptor::Deadline::max()));
+  }
+
+  EXPECT_EQ(6, pool.getFailedCount());
+  EXPECT_EQ(0, pool.getConnectingCount());
+}
@@ -0,0 +1,190 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <gmock/gmock.h>
+
+#include "Core/Network.h"
+#include "Core/StreamFileDescriptor.h"
+#include "Core/TcpClient.h"
+
+#include "ConnectedPair.h"
+
+using MarathonKit::Core::ListeningFileDescriptor;
+using MarathonKit::Core::Network;
+using MarathonKit::Core::StreamFileDescriptor;
+using MarathonKit::Core::TcpClient;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+
+class TcpClientTest : public testing::Test {
+protected:
+
+  TcpClientTest():
+    mClient(),
+    mServer() {}
+
+  virtual void SetUp() {
+    StreamPair pair;
+    mClient = TcpClient(shared_ptr<StreamFileDescriptor>(
+        std::move(pair.first)));
+    mServer = std::move(pair.second);
+  }
+
+  TcpClient mClient;
+  unique_ptr<StreamFileDescriptor> mServer;
+
+};
+
+TEST_F(TcpClientTest, backgroundReceiverDeliversLines) {
+  mServer->write("ab");
+  EXPECT_EQ(0, mClient.linesReady());
+
+  mClient.startBackgroundReceiver();
+  ASSERT_TRUE(mClient.hasBackgroundReceiver());
+
+  mServer->write("cd\nef\n");
+  EXPECT_EQ("abcd", mClient.getLine());
+
+  string line;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  ASSERT_TRUE(mClient.getLine(line, deadline));
+  EXPECT_EQ("ef", line);
+
+  EXPECT_EQ(0, mClient.linesReady());
+  EXPECT_FALSE(mClient.getLine(line, std::chrono::steady_clock::now()));
+  EXPECT_THROW(mClient.getChar(), std::runtime_error);
+}
+
+TEST_F(TcpClientTest, backgroundReceiverReportsClosedConnection) {
+  mClient.startBackgroundReceiver();
+
+  mServer->write("last\n");
+  mServer.reset();
+
+  EXPECT_EQ("last", mClient.getLine());
+  EXPECT_THROW(mClient.getLine(), std::runtime_error);
+}
+
+TEST_F(TcpClientTest, backgroundReceiverIsMovable) {
+  mClient.startBackgroundReceiver();
+  TcpClient client = std::move(mClient);
+
+  mServer->write("line\n");
+  EXPECT_EQ("line", client.getLine());
+  EXPECT_FALSE(mClient.isConnected());
+}
+
+TEST_F(TcpClientTest, sendsAndReceivesConcurrently) {
+  const int COUNT = 20000;
+  TcpClient server(shared_ptr<StreamFileDescriptor>(std::move(mServer)));
+
+  // Both directions run at the same time, each side of each client on its
+  // own thread.
+  std::thread clientSender([this, COUNT]() {
+    for (int i = 0; i < COUNT; ++i) {
+      mClient.sendLine("c" + std::to_string(i));
+    }
+  });
+  std::thread serverSender([&server, COUNT]() {
+    for (int i = 0; i < COUNT; ++i) {
+      server.sendLine("s" + std::to_string(i));
+    }
+  });
+  std::thread clientReceiver([this, COUNT]() {
+    for (int i = 0; i < COUNT; ++i) {
+      EXPECT_EQ("s" + std::to_string(i), mClient.getLine());
+    }
+  });
+  for (int i = 0; i < COUNT; ++i) {
+    EXPECT_EQ("c" + std::to_string(i), server.getLine());
+  }
+
+  clientSender.join();
+  serverSender.join();
+  clientReceiver.join();
+}
+
+TEST_F(TcpClientTest, sendFieldsSeparatesFieldsWithSpaces) {
+  TcpClient server(shared_ptr<StreamFileDescriptor>(std::move(mServer)));
+  string name("bot");
+
+  mClient.sendFields("MOVE", name, 3, -4L, 0.5, 'x');
+  mClient.sendFields();
+
+  EXPECT_EQ("MOVE bot 3 -4 0.5 x", server.getLine());
+  EXPECT_EQ("", server.getLine());
+}
+
+TEST_F(TcpClientTest, sendStopsAtDeadlineWhenPeerStopsReading) {
+  // Far more than the socket buffers take, and the server never reads.
+  string data(16 * 1024 * 1024, 'x');
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(mClient.sendRaw(data, start + std::chrono::milliseconds(50)));
+  EXPECT_FALSE(mClient.sendLine(
+      data,
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(50)));
+  EXPECT_LT(
+      std::chrono::steady_clock::now() - start,
+      std::chrono::seconds(5));
+}
+
+TEST(TcpClientConnectTest, connectsWithinTimeout) {
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0");
+
+  TcpClient client(
+      "127.0.0.1",
+      listener->getLocalService(),
+      std::chrono::seconds(5));
+
+  EXPECT_TRUE(client.isConnected());
+}
+
+TEST(TcpClientConnectTest, staysDisconnectedAfterTimeout) {
+  // With a backlog of zero, the first connection fills the accept queue and
+  // the handshakes of the following ones do not complete.
+  unique_ptr<ListeningFileDescriptor> listener =
+      Network::createTcpListener("0", 0);
+  TcpClient first("127.0.0.1", listener->getLocalService());
+  ASSERT_TRUE(first.isConnected());
+
+  auto start = std::chrono::steady_clock::now();
+  TcpClient second(
+      "127.0.0.1",
+      listener->getLocalService(),
+      std::chrono::milliseconds(100));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_FALSE(second.isConnected());
+  EXPECT_GE(elapsed, std::chrono::milliseconds(100));
+  EXPECT_LT(elapsed, std::chrono::milliseconds(900));
+}
@@ -0,0 +1,130 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "Core/StreamFileDescriptor.h"
+#include "Core/TcpClient.h"
+#include "Core/TcpPipeline.h"
+
+#include "ConnectedPair.h"
+
+using MarathonKit::Core::StreamFileDescriptor;
+using MarathonKit::Core::TcpClient;
+using MarathonKit::Core::TcpPipeline;
+using std::shared_ptr;
+using std::string;
+
+class TcpPipelineTest : public testing::Test {
+protected:
+
+  TcpPipelineTest():
+    mClient(),
+    mServer() {}
+
+  virtual void SetUp() {
+    StreamPair pair;
+    mClient = TcpClient(shared_ptr<StreamFileDescriptor>(
+        std::move(pair.first)));
+    mServer = std::move(pair.second);
+  }
+
+  TcpClient mClient;
+  std::unique_ptr<StreamFileDescriptor> mServer;
+
+};
+
+TEST_F(TcpPipelineTest, sendsQueuedCommandsWithASingleWrite) {
+  TcpPipeline pipeline(mClient);
+
+  std::vector<string> responses;
+  auto callback = [&responses](const string& response) {
+    responses.push_back(response);
+  };
+
+  pipeline.enqueue("a", callback);
+  pipeline.enqueue("b", callback);
+  pipeline.enqueue("c", callback);
+  EXPECT_EQ(3, pipeline.getQueuedCount());
+
+  pipeline.flush();
+  EXPECT_EQ(0, pipeline.getQueuedCount());
+  EXPECT_EQ(3, pipeline.getPendingCount());
+  EXPECT_EQ("a\nb\nc\n", mServer->read());
+
+  mServer->write("1\n2\n3\n");
+  pipeline.waitForAll();
+
+  EXPECT_EQ(0, pipeline.getPendingCount());
+  EXPECT_EQ((std::vector<string>{"1", "2", "3"}), responses);
+}
+
+TEST_F(TcpPipelineTest, processResponsesDoesNotBlock) {
+  TcpPipeline pipeline(mClient);
+
+  std::future<string> first = pipeline.enqueue("a");
+  std::future<string> second = pipeline.enqueue("b");
+  pipeline.flush();
+  EXPECT_EQ("a\nb\n", mServer->read());
+
+  mServer->write("1\n");
+
+  EXPECT_EQ(1, pipeline.processResponses());
+  EXPECT_EQ("1", first.get());
+  EXPECT_EQ(1, pipeline.getPendingCount());
+  EXPECT_EQ(0, pipeline.processResponses());
+  EXPECT_EQ(
+      std::future_status::timeout,
+      second.wait_for(std::chrono::seconds(0)));
+}
+
+TEST_F(TcpPipelineTest, waitForAllStopsAtDeadline) {
+  TcpPipeline pipeline(mClient);
+
+  pipeline.enqueue("a");
+
+  EXPECT_FALSE(pipeline.waitForAll(std::chrono::steady_clock::now()));
+  EXPECT_EQ(1, pipeline.getPendingCount());
+}
+
+TEST_F(TcpPipelineTest, waitForAllStopsAtDeadlineWhenPeerDoesNotRead) {
+  TcpPipeline pipeline(mClient);
+
+  // Far more than the socket buffers take, and the server never reads.
+  string command(16 * 1024 * 1024, 'x');
+  pipeline.enqueue(command);
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(pipeline.waitForAll(start + std::chrono::milliseconds(50)));
+  EXPECT_LT(
+      std::chrono::steady_clock::now() - start,
+      std::chrono::seconds(5));
+  EXPECT_EQ(1, pipeline.getPendingCount());
+}
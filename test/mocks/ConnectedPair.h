@@ -0,0 +1,63 @@
+/*
+ * This file is part of MarathonKit.
+ * Copyright (C) 2015 Jakub Zika
+ *
+ * MarathonKit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * I am providing code in this repository to you under an open source license.
+ * Because this is my personal repository, the license you receive to my code is
+ * from me and not from my employer (Facebook).
+ */
+
+#ifndef MARATHON_KIT_CONNECTED_PAIR_H_
+#define MARATHON_KIT_CONNECTED_PAIR_H_
+
+#include <sys/socket.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "Core/MessageFileDescriptor.h"
+#include "Core/StreamFileDescriptor.h"
+
+// Both ends of a connected Unix socket pair, for tests that need a real
+// descriptor but not a network connection.
+template <typename Descriptor, int TYPE>
+struct ConnectedPair {
+
+  ConnectedPair():
+    first(),
+    second() {
+    int fds[2];
+    if (socketpair(AF_UNIX, TYPE, 0, fds) != 0) {
+      throw std::runtime_error(std::strerror(errno));
+    }
+    first = Descriptor::createOwnerOf(fds[0]);
+    second = Descriptor::createOwnerOf(fds[1]);
+  }
+
+  std::unique_ptr<Descriptor> first;
+  std::unique_ptr<Descriptor> second;
+
+};
+
+typedef ConnectedPair<MarathonKit::Core::StreamFileDescriptor, SOCK_STREAM>
+    StreamPair;
+typedef ConnectedPair<MarathonKit::Core::MessageFileDescriptor, SOCK_DGRAM>
+    MessagePair;
+
+#endif
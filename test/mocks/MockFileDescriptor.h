@@ -35,6 +35,15 @@ public:
   MOCK_CONST_METHOD0(isReadyForReading, bool());
   MOCK_CONST_METHOD0(read, std::string());
   MOCK_CONST_METHOD1(write, void(const std::string&));
+  MOCK_CONST_METHOD1(waitForReading, bool(Deadline));
+
+};
+
+// Also mocks readWithTimestamp, which otherwise falls back to read.
+class MockTimestampedFileDescriptor : public MockFileDescriptor {
+public:
+
+  MOCK_CONST_METHOD1(readWithTimestamp, std::string(Timestamp&));
 
 };
 